@@ -0,0 +1,836 @@
+/* See LICENSE file for copyright and license details. */
+
+/* sent-bench - measure the hot paths of sent on synthetic decks
+ *
+ * sent.c is compiled into this binary as a whole, so its internal
+ * functions can be timed without exporting them. */
+#define main sentmain
+#include "sent.c"
+#undef main
+
+#include <sys/resource.h>
+#include <time.h>
+
+#define NTEXTSLIDES 10000
+#define NSRCHSLIDES 33000 /* about 100k lines */
+#define BIGW        4000
+#define BIGH        3000
+#define ALPHAW      2000
+#define ALPHAH      2000
+#define NFRAMES     90
+#define FRAMEW      320
+#define FRAMEH      180
+#define NSOAKFRAMES 8
+
+static char tmpdir[64];
+static int iterations = 10;
+static int soakcycles = 200;
+
+static double
+now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int
+cmpdouble(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+/* one line per phase: name, unit, iterations, throughput and
+ * per-iteration percentiles in microseconds */
+static void
+report(const char *phase, const char *unit, double ops, double *t, int n)
+{
+	double total = 0;
+	int i;
+
+	for (i = 0; i < n; i++)
+		total += t[i];
+	qsort(t, n, sizeof(*t), cmpdouble);
+	printf("%s\t%s\t%d\t%.0f\t%.1f\t%.1f\t%.1f\t%.1f\t%.1f\n", phase, unit, n,
+	       ops * n / total, t[0] * 1e6, t[n / 2] * 1e6, t[n * 9 / 10] * 1e6,
+	       t[n * 99 / 100] * 1e6, t[n - 1] * 1e6);
+	fflush(stdout);
+}
+
+static void
+skip(const char *phase, const char *why)
+{
+	printf("# %s skipped: %s\n", phase, why);
+}
+
+static char *
+tmppath(const char *name)
+{
+	static char path[PATH_MAX];
+
+	snprintf(path, sizeof(path), "%s/%s", tmpdir, name);
+	return path;
+}
+
+static void
+writedeck(const char *name, int nslides)
+{
+	FILE *fp;
+	int i, j;
+
+	if (!(fp = fopen(tmppath(name), "w")))
+		die("sent-bench: Unable to create '%s':", name);
+	for (i = 0; i < nslides; i++) {
+		if (i % 50 == 0)
+			fprintf(fp, "# section %d\n", i / 50);
+		for (j = 0; j <= i % 5; j++)
+			fprintf(fp, "%sline %d of slide %d with some text\n",
+			        j == 1 ? "\\" : "", j, i);
+		fputc('\n', fp);
+	}
+	fclose(fp);
+}
+
+/* a gradient, shifted right by shift pixels */
+static void
+writeff(const char *name, uint32_t w, uint32_t h, int alpha, uint32_t shift)
+{
+	FILE *fp;
+	uint32_t x, y, hdr[2] = { htonl(w), htonl(h) };
+	uint16_t *row = ecalloc(w, 2 * strlen("RGBA"));
+
+	if (!(fp = fopen(tmppath(name), "w")))
+		die("sent-bench: Unable to create '%s':", name);
+	fputs("farbfeld", fp);
+	fwrite(hdr, sizeof(hdr), 1, fp);
+	for (y = 0; y < h; y++) {
+		for (x = 0; x < w; x++) {
+			row[x * 4 + 0] = htons((x + shift) % w * 65535 / w);
+			row[x * 4 + 1] = htons(y * 65535 / h);
+			row[x * 4 + 2] = htons((x ^ y) * 257);
+			row[x * 4 + 3] = alpha ? htons((x + y) * 65535 / (w + h)) : 0xFFFF;
+		}
+		fwrite(row, 2 * strlen("RGBA"), w, fp);
+	}
+	free(row);
+	fclose(fp);
+}
+
+static void
+loaddeck(const char *name)
+{
+	FILE *fp;
+
+	cleanup(1);
+	slidecount = 0;
+	if (!(fp = fopen(tmppath(name), "r")))
+		die("sent-bench: Unable to open '%s':", name);
+	load(fp);
+	fclose(fp);
+}
+
+static void
+benchload(double *t)
+{
+	double t0;
+	int i;
+
+	writedeck("text", NTEXTSLIDES);
+	for (i = 0; i < iterations; i++) {
+		t0 = now();
+		loaddeck("text");
+		t[i] = now() - t0;
+	}
+	report("load", "slides", slidecount, t, iterations);
+}
+
+/* decode name; with scale, also time the scalers of the decoded image,
+ * reporting them with scale appended to their phase names */
+static void
+benchffload(double *t, const char *name, const char *phase, const char *scale)
+{
+	Slide s = { 0 };
+	char sphase[32];
+	double t0;
+	int i;
+
+	s.embed = tmppath(name);
+	for (i = 0; i < iterations; i++) {
+		t0 = now();
+		ffload(&s);
+		ffwait();
+		t[i] = now() - t0;
+		if (i + 1 < iterations) {
+			fffree(s.img);
+			s.img = NULL;
+		}
+	}
+	report(phase, "pixels", (double)s.img->bufwidth * s.img->bufheight,
+	       t, iterations);
+
+	/* keep the last decode around for the scaler */
+	if (scale) {
+		XImage ximg = { 0 };
+		unsigned int w = 1440, h = 1440 * BIGH / BIGW;
+
+		ximg.width = w;
+		ximg.height = h;
+		ximg.bytes_per_line = w * 4;
+		ximg.bits_per_pixel = 32;
+		ximg.byte_order = LSBFirst;
+		ximg.red_mask = 0xFF0000;
+		ximg.green_mask = 0xFF00;
+		ximg.blue_mask = 0xFF;
+		ximg.data = ecalloc(h, ximg.bytes_per_line);
+		s.img->ximg = &ximg;
+		for (i = 0; i < iterations; i++) {
+			t0 = now();
+			ffscale(s.img);
+			t[i] = now() - t0;
+		}
+		snprintf(sphase, sizeof(sphase), "ffscale%s", scale);
+		report(sphase, "pixels", (double)w * h, t, iterations);
+
+		/* dithered to RGB565 as for 16 bit displays and -l */
+		ximg.bytes_per_line = w * 2;
+		ximg.bits_per_pixel = 16;
+		ximg.red_mask = 0xF800;
+		ximg.green_mask = 0x07E0;
+		ximg.blue_mask = 0x001F;
+		for (i = 0; i < iterations; i++) {
+			t0 = now();
+			ffscale(s.img);
+			t[i] = now() - t0;
+		}
+		snprintf(sphase, sizeof(sphase), "ffscale_565%s", scale);
+		report(sphase, "pixels", (double)w * h, t, iterations);
+		ximg.bytes_per_line = w * 4;
+		ximg.bits_per_pixel = 32;
+		ximg.red_mask = 0xFF0000;
+		ximg.green_mask = 0xFF00;
+		ximg.blue_mask = 0xFF;
+
+		s.img->ximg = NULL;
+		for (i = 0; i < iterations; i++) {
+			fffree(s.img);
+			s.img = NULL;
+			ffload(&s);
+			ffwait();
+			t0 = now();
+			while (ffmipmap(s.img))
+				;
+			t[i] = now() - t0;
+		}
+		snprintf(sphase, sizeof(sphase), "ffmipmap%s", scale);
+		report(sphase, "pixels", (double)BIGW * BIGH, t, iterations);
+
+		s.img->ximg = &ximg;
+		for (i = 0; i < iterations; i++) {
+			t0 = now();
+			ffscale(s.img);
+			t[i] = now() - t0;
+		}
+		snprintf(sphase, sizeof(sphase), "ffscale_mip%s", scale);
+		report(sphase, "pixels", (double)w * h, t, iterations);
+		free(ximg.data);
+		s.img->ximg = NULL;
+	}
+	fffree(s.img);
+}
+
+/* an XImage without a display, with pixel accessors for its format */
+static void
+fakeximage(XImage *ximg, int w, int h, int bpp, int order, unsigned long rm,
+           unsigned long gm, unsigned long bm)
+{
+	memset(ximg, 0, sizeof(*ximg));
+	ximg->width = w;
+	ximg->height = h;
+	ximg->format = ZPixmap;
+	ximg->byte_order = ximg->bitmap_bit_order = order;
+	ximg->bitmap_unit = ximg->bitmap_pad = 32;
+	ximg->depth = bpp == 32 ? 24 : bpp;
+	ximg->bits_per_pixel = bpp;
+	ximg->bytes_per_line = w * bpp / 8;
+	ximg->red_mask = rm;
+	ximg->green_mask = gm;
+	ximg->blue_mask = bm;
+	ximg->data = ecalloc(h, ximg->bytes_per_line);
+	if (!XInitImage(ximg))
+		die("sent-bench: Unable to initiate XImage");
+}
+
+/* die unless pixel x of a farbfeld row is r, g, b */
+static void
+checkrow(const char *phase, uint16_t *row, int x, uint16_t r, uint16_t g,
+         uint16_t b)
+{
+	if (ntohs(row[x * 4]) != r || ntohs(row[x * 4 + 1]) != g ||
+	    ntohs(row[x * 4 + 2]) != b)
+		die("sent-bench: %s: read %04x %04x %04x, not %04x %04x %04x",
+		    phase, ntohs(row[x * 4]), ntohs(row[x * 4 + 1]),
+		    ntohs(row[x * 4 + 2]), r, g, b);
+}
+
+/* converting an exported frame of a 16 bit display to farbfeld, checking
+ * that known pixels come back at full 16 bit range, also from a 32 bit
+ * image in the other byte order */
+static void
+benchffrow(double *t)
+{
+	XImage ximg;
+	uint16_t *row = ecalloc(1920, 2 * strlen("RGBA"));
+	uint16_t one = 1;
+	double t0;
+	int i, y, swapped = *(unsigned char *)&one ? MSBFirst : LSBFirst;
+
+	fakeximage(&ximg, 1920, 1080, 16, LSBFirst, 0xF800, 0x07E0, 0x001F);
+	XPutPixel(&ximg, 0, 0, 0xFFFF);
+	XPutPixel(&ximg, 1, 0, 31 << 11 | 32 << 5 | 16);
+	for (i = 0; i < iterations; i++) {
+		t0 = now();
+		for (y = 0; y < ximg.height; y++)
+			ffrow(&ximg, y, row);
+		t[i] = now() - t0;
+	}
+	report("ffrow_565", "pixels", 1920.0 * 1080, t, iterations);
+	ffrow(&ximg, 0, row);
+	checkrow("ffrow_565", row, 0, 0xFFFF, 0xFFFF, 0xFFFF);
+	checkrow("ffrow_565", row, 1, 0xFFFF, 0x8208, 0x8421);
+	free(ximg.data);
+
+	fakeximage(&ximg, 2, 1, 32, swapped, 0xFF0000, 0xFF00, 0xFF);
+	XPutPixel(&ximg, 1, 0, 0x123456);
+	ffrow(&ximg, 0, row);
+	checkrow("ffrow_swapped", row, 1, 0x1212, 0x3434, 0x5656);
+	free(ximg.data);
+	free(row);
+}
+
+/* every keystroke of typing a query that narrows to a single slide */
+static void
+benchsearch(void)
+{
+	static const char typed[] = "of slide 32999 with";
+	size_t k, n = strlen(typed);
+	double t0, *t = ecalloc(iterations * n, sizeof(*t));
+	int i;
+
+	/* the index is built while idle before the first search */
+	writedeck("search", NSRCHSLIDES);
+	for (i = 0; i < iterations; i++) {
+		loaddeck("search");
+		t0 = now();
+		indexslides(INT_MAX);
+		t[i] = now() - t0;
+	}
+	report("index", "slides", slidecount, t, iterations);
+
+	for (i = 0; i < iterations; i++) {
+		searchfrom = 0;
+		for (k = 1; k <= n; k++) {
+			query[k - 1] = typed[k - 1];
+			querylen = k;
+			t0 = now();
+			searchupdate(k > 1);
+			t[i * n + k - 1] = now() - t0;
+		}
+	}
+	if (nmatches != 1)
+		die("sent-bench: search found %d slides instead of 1", nmatches);
+	report("search", "keys", 1, t, iterations * n);
+
+	querylen = 0;
+	free(t);
+}
+
+/* a command on the control socket until its reply has arrived */
+static void
+benchctl(double *t)
+{
+	struct sockaddr_un sa = { .sun_family = AF_UNIX };
+	struct pollfd pfd[1 + MAXCLIENTS];
+	char cmd[32], reply[32];
+	struct stat st;
+	mode_t mask;
+	double t0;
+	int i, fd, n;
+
+	/* private to the user whatever the umask, which is left as it was */
+	mask = umask(0);
+	ctlopen(tmppath("sock"));
+	if (umask(mask) != 0)
+		die("sent-bench: ctlopen() did not restore the umask");
+	if (stat(ctlpath, &st) < 0 || (st.st_mode & 0777) != 0600)
+		die("sent-bench: socket is not private to the user");
+	strcpy(sa.sun_path, ctlpath);
+	if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0 ||
+	    connect(fd, (struct sockaddr *)&sa, sizeof(sa)) < 0)
+		die("sent-bench: Unable to connect:");
+	ctlpollfds(pfd);
+	poll(pfd, 1 + MAXCLIENTS, -1);
+	ctlpump(pfd);
+
+	for (i = 0; i < iterations; i++) {
+		n = snprintf(cmd, sizeof(cmd), "goto %d\n", i % slidecount + 1);
+		t0 = now();
+		if (write(fd, cmd, n) != n)
+			die("sent-bench: Unable to write:");
+		ctlpollfds(pfd);
+		if (poll(pfd, 1 + MAXCLIENTS, -1) < 0)
+			die("sent-bench: Unable to poll:");
+		ctlpump(pfd);
+		if (read(fd, reply, sizeof(reply)) <= 0 || strncmp(reply, "ok", 2))
+			die("sent-bench: No reply");
+		t[i] = now() - t0;
+	}
+	report("ctl_goto", "commands", 1, t, iterations);
+	close(fd);
+	ctlclose();
+}
+
+/* current resident size in KiB; the peak from getrusage() where there
+ * is no /proc */
+static long
+rss(void)
+{
+	struct rusage ru;
+	FILE *fp;
+	long size, res = -1;
+
+	if ((fp = fopen("/proc/self/statm", "r"))) {
+		if (fscanf(fp, "%ld %ld", &size, &res) != 2)
+			res = -1;
+		fclose(fp);
+	}
+	if (res >= 0)
+		return res * (sysconf(_SC_PAGESIZE) / 1024);
+	getrusage(RUSAGE_SELF, &ru);
+	return ru.ru_maxrss;
+}
+
+/* after the first tenth of the cycles every buffer should have been
+ * allocated once, so the resident size sampled after each cycle must
+ * not trend upwards: fail if its least squares slope is above 1 KiB
+ * per cycle */
+static void
+soakcheck(const char *phase, long *rs)
+{
+	int i, warm = soakcycles / 10, n = soakcycles - warm;
+	double mx = 0, my = 0, sxy = 0, sxx = 0, slope;
+
+	if (n < 2)
+		return;
+	for (i = warm; i < soakcycles; i++) {
+		mx += i;
+		my += rs[i];
+	}
+	mx /= n;
+	my /= n;
+	for (i = warm; i < soakcycles; i++) {
+		sxy += (i - mx) * (rs[i] - my);
+		sxx += (i - mx) * (i - mx);
+	}
+	slope = sxy / sxx;
+	printf("# %s: rss %ld KiB after warm-up, %ld KiB after %d cycles, "
+	       "%.2f KiB per cycle\n", phase, rs[warm], rs[soakcycles - 1],
+	       soakcycles, slope);
+	if (slope > 1)
+		die("sent-bench: %s: memory grows by %.2f KiB per cycle",
+		    phase, slope);
+}
+
+/* the deck of the soak phases, with text, a shared image and a short
+ * frame sequence, so that a cycle is cheap enough to run many */
+static void
+writesoak(void)
+{
+	FILE *fp;
+	char name[32];
+	int i;
+
+	writeff("small.ff", FRAMEW * 2, FRAMEH * 2, 1, 0);
+	mkdir(tmppath("soakframes"), 0700);
+	for (i = 0; i < NSOAKFRAMES; i++) {
+		snprintf(name, sizeof(name), "soakframes/%d.ff", i);
+		writeff(name, FRAMEW / 4, FRAMEH / 4, 0, i);
+	}
+	if (!(fp = fopen(tmppath("soak"), "w")))
+		die("sent-bench: Unable to create 'soak':");
+	for (i = 0; i < 50; i++)
+		fprintf(fp, "slide %d\nwith 😀 two lines\n\n@%s\n\n", i,
+		        tmppath(i % 10 ? "small.ff" : "soakframes"));
+	fclose(fp);
+}
+
+/* reload a deck with text, shared and animated images over and over */
+static void
+benchsoak(void)
+{
+	double t0, *t = ecalloc(soakcycles, sizeof(*t));
+	long *rs = ecalloc(soakcycles, sizeof(*rs));
+	int i, j;
+
+	writesoak();
+	for (i = 0; i < soakcycles; i++) {
+		t0 = now();
+		loaddeck("soak");
+		for (j = 0; j < slidecount; j++)
+			ffload(&slides[j]);
+		animfill(&slides[0]);
+		ffwait();
+		while (ffidle() || indexslides(INDEXBATCH))
+			;
+		t[i] = now() - t0;
+		rs[i] = rss();
+	}
+	report("soak_reload", "slides", slidecount, t, soakcycles);
+	soakcheck("soak_reload", rs);
+	free(rs);
+	cleanup(1);
+	slidecount = 0;
+	free(t);
+}
+
+/* headers of images too wide or too tall fail before any allocation */
+static void
+benchffhuge(void)
+{
+	static const uint32_t sides[][2] = { { 100000000, 1 }, { 1, 100000000 } };
+	Slide s = { 0 };
+	FILE *fp;
+	uint32_t hdr[2];
+	unsigned int i;
+
+	for (i = 0; i < LEN(sides); i++) {
+		if (!(fp = fopen(tmppath("huge.ff"), "w")))
+			die("sent-bench: Unable to create 'huge.ff':");
+		hdr[0] = htonl(sides[i][0]);
+		hdr[1] = htonl(sides[i][1]);
+		fputs("farbfeld", fp);
+		fwrite(hdr, sizeof(hdr), 1, fp);
+		fclose(fp);
+
+		s.embed = tmppath("huge.ff");
+		ffload(&s);
+		ffwait();
+		if (!(s.img->state & FAILED) || s.img->buf)
+			die("sent-bench: %ux%u image was not refused",
+			    sides[i][0], sides[i][1]);
+		fffree(s.img);
+		s.img = NULL;
+	}
+}
+
+/* slides showing the same file share one decode */
+static void
+benchffshared(double *t)
+{
+	Slide s[40] = { { 0 } };
+	Image *img, *other;
+	double t0;
+	unsigned int j;
+	int i, fd;
+
+	for (i = 0; i < iterations; i++) {
+		t0 = now();
+		for (j = 0; j < LEN(s); j++) {
+			s[j].embed = tmppath("alpha.ff");
+			ffload(&s[j]);
+		}
+		ffwait();
+		t[i] = now() - t0;
+		for (j = 0; j < LEN(s); j++) {
+			fffree(s[j].img);
+			s[j].img = NULL;
+		}
+	}
+	report("ffload_shared", "slides", LEN(s), t, iterations);
+
+	/* a copy is shared, a file whose hash merely collides is not */
+	writeff("copy.ff", ALPHAW, ALPHAH, 1, 0);
+	writeff("shifted.ff", ALPHAW, ALPHAH, 1, 1);
+	img = ffopen(tmppath("alpha.ff"));
+	if ((fd = open(tmppath("shifted.ff"), O_RDONLY)) < 0 ||
+	    filehash(fd, &img->hash, &img->size) < 0)
+		die("sent-bench: Unable to hash 'shifted.ff':");
+	close(fd);
+	if ((other = ffopen(tmppath("shifted.ff"))) == img)
+		die("sent-bench: files with colliding hashes were shared");
+	fffree(other);
+	if ((fd = open(tmppath("copy.ff"), O_RDONLY)) < 0 ||
+	    filehash(fd, &img->hash, &img->size) < 0)
+		die("sent-bench: Unable to hash 'copy.ff':");
+	close(fd);
+	if ((other = ffopen(tmppath("copy.ff"))) != img)
+		die("sent-bench: identical files were not shared");
+	fffree(other);
+	fffree(img);
+}
+
+/* a frame sequence longer than the frames kept decoded ahead: filling
+ * them when the slide is shown, then each step of playing it */
+static void
+benchframes(double *t)
+{
+	Slide s = { 0 };
+	char name[32];
+	double t0, *st = ecalloc(iterations * NFRAMES, sizeof(*st));
+	int i, k;
+
+	mkdir(tmppath("frames"), 0700);
+	for (k = 0; k < NFRAMES; k++) {
+		snprintf(name, sizeof(name), "frames/%03d.ff", k);
+		writeff(name, FRAMEW, FRAMEH, 0, k);
+	}
+	s.embed = tmppath("frames");
+	for (i = 0; i < iterations; i++) {
+		t0 = now();
+		ffload(&s);
+		animfill(&s);
+		ffwait();
+		t[i] = now() - t0;
+
+		for (k = 0; k < NFRAMES; k++) {
+			t0 = now();
+			s.frame = (s.frame + 1) % s.nframes;
+			s.img = s.frames[s.frame];
+			animfill(&s);
+			ffwait();
+			st[i * NFRAMES + k] = now() - t0;
+		}
+		fffreeslide(&s);
+	}
+	report("ffload_frames", "frames", MIN(animbuffer, NFRAMES), t, iterations);
+	report("anim_step", "frames", 1, st, iterations * NFRAMES);
+	free(st);
+}
+
+/* every step of a transition between the first two slides, until the
+ * server has drawn it */
+static void
+benchtrans(int kind, const char *phase)
+{
+	double t0, *t = NULL;
+	int i, n = 0, cap = 0;
+
+	xw.win = d->root;
+	for (i = 0; i < iterations; i++) {
+		idx = 0;
+		xdrawslide(&slides[idx]);
+		transbegin(kind, 1);
+		idx = 1;
+		while (transkind) {
+			if (n == cap) {
+				cap = cap ? cap * 2 : 256;
+				if (!(t = realloc(t, cap * sizeof(*t))))
+					die("sent-bench: Unable to allocate:");
+			}
+			t0 = now();
+			transdraw();
+			XSync(xw.dpy, False);
+			t[n++] = now() - t0;
+		}
+	}
+	xw.win = None;
+	report(phase, "frames", 1, t, n);
+	free(t);
+}
+
+/* reload and draw every slide, the emoji lines and the animation frames
+ * over and over, as a kiosk would, so that the XImages, pixmaps and
+ * pictures of the images are made and released every cycle */
+static void
+benchsoakdraw(Slide *emoji)
+{
+	double t0, *t = ecalloc(soakcycles, sizeof(*t));
+	long *rs = ecalloc(soakcycles, sizeof(*rs));
+	int i, j;
+
+	for (i = 0; i < soakcycles; i++) {
+		t0 = now();
+		loaddeck("soak");
+		for (j = 0; j < slidecount; j++)
+			ffload(&slides[j]);
+		ffwait();
+		for (idx = 0; idx < slidecount; idx++) {
+			if (slides[idx].nframes) {
+				slides[idx].frame = (slides[idx].frame + 1) %
+				                    slides[idx].nframes;
+				slides[idx].img = slides[idx].frames[slides[idx].frame];
+				animfill(&slides[idx]);
+				ffwait();
+			}
+			xdrawslide(&slides[idx]);
+			if (slides[idx].img)
+				slides[idx].img->state &= ~SCALED;
+		}
+		xdrawslide(emoji);
+		XSync(xw.dpy, False);
+		t[i] = now() - t0;
+		rs[i] = rss();
+	}
+	idx = 0;
+	report("soak_draw", "slides", slidecount + 1, t, soakcycles);
+	soakcheck("soak_draw", rs);
+	free(rs);
+	free(t);
+}
+
+static void
+benchtext(double *t)
+{
+	static const char *emoji[] = {
+		"😀 sent 🎉 presentations ✓ without 💥 LaTeX 🚀",
+		"→ ★ ☃ 日本語 テキスト 🐈 and ASCII mixed",
+		"plain ASCII line that the primary font fully covers",
+		"🍕🍔🍟🌭🍿🧂🥓🥚🍳🧇🥞🧈🍞🥐🥨🥯🥖🫓🧀🥗",
+	};
+	Slide s = { .linecount = LEN(emoji), .lines = (char **)emoji };
+	unsigned int w, h, j;
+	double t0;
+	int i, n;
+
+	if (!(xw.dpy = XOpenDisplay(NULL))) {
+		skip("getfontsize", "unable to open display");
+		skip("drw_text", "unable to open display");
+		return;
+	}
+	xw.scr = XDefaultScreen(xw.dpy);
+	xw.vis = XDefaultVisual(xw.dpy, xw.scr);
+	xinitdrw(XRootWindow(xw.dpy, xw.scr));
+	resize(1920, 1080);
+
+	/* warm up the fallback font chains */
+	getfontsize(&s, &w, &h);
+
+	n = MIN(slidecount, 1000);
+	for (i = 0; i < iterations; i++) {
+		t0 = now();
+		for (j = 0; j < n; j++)
+			getfontsize(&slides[j], &w, &h);
+		getfontsize(&s, &w, &h);
+		t[i] = now() - t0;
+	}
+	report("getfontsize", "slides", n + 1, t, iterations);
+
+	for (i = 0; i < iterations; i++) {
+		t0 = now();
+		for (j = 0; j < s.linecount; j++)
+			drw_text(d, 0, j * d->fonts->h, xw.w, d->fonts->h, 0,
+			         s.lines[j], 0);
+		XSync(xw.dpy, False);
+		t[i] = now() - t0;
+	}
+	report("drw_text", "lines", s.linecount, t, iterations);
+
+	benchtrans(TransFade, "trans_fade");
+	benchtrans(TransSlide, "trans_slide");
+	benchtrans(TransWipe, "trans_wipe");
+	benchsoakdraw(&s);
+
+	cleanup(0);
+	xw.dpy = NULL;
+}
+
+static void
+rmtmp(void)
+{
+	static const char *files[] = {
+		"text", "search", "soak", "big.ff", "alpha.ff", "small.ff",
+		"huge.ff", "copy.ff", "shifted.ff"
+	};
+	char name[32];
+	unsigned int i;
+
+	for (i = 0; i < LEN(files); i++)
+		unlink(tmppath(files[i]));
+	for (i = 0; i < NFRAMES; i++) {
+		snprintf(name, sizeof(name), "frames/%03u.ff", i);
+		unlink(tmppath(name));
+	}
+	rmdir(tmppath("frames"));
+	for (i = 0; i < NSOAKFRAMES; i++) {
+		snprintf(name, sizeof(name), "soakframes/%u.ff", i);
+		unlink(tmppath(name));
+	}
+	rmdir(tmppath("soakframes"));
+	rmdir(tmpdir);
+}
+
+static void
+benchusage(void)
+{
+	die("usage: %s [-n iterations] [-s soakcycles]", argv0);
+}
+
+int
+main(int argc, char *argv[])
+{
+	static Clr scheme[2] = {
+		[ColBg] = { .pixel = 0xFFFFFF, .color = { .red = 0xFFFF,
+		            .green = 0xFFFF, .blue = 0xFFFF } }
+	};
+	double *t;
+
+	ARGBEGIN {
+	case 'n':
+		if ((iterations = atoi(EARGF(benchusage()))) <= 0)
+			benchusage();
+		break;
+	case 's':
+		if ((soakcycles = atoi(EARGF(benchusage()))) <= 0)
+			benchusage();
+		break;
+	default:
+		benchusage();
+	} ARGEND
+
+	snprintf(tmpdir, sizeof(tmpdir), "/tmp/sent-bench.%d", (int)getpid());
+	if (mkdir(tmpdir, 0700) < 0)
+		die("sent-bench: Unable to create '%s':", tmpdir);
+	atexit(rmtmp);
+	traceopen(getenv("SENT_TRACE"));
+
+	/* the scaler composites onto the background without a display */
+	sc = scheme;
+
+	t = ecalloc(iterations, sizeof(*t));
+	printf("# phase\tunit\tn\tunits/s\tmin_us\tp50_us\tp90_us\tp99_us\tmax_us\n");
+
+	benchload(t);
+	benchsearch();
+	benchctl(t);
+
+	writeff("big.ff", BIGW, BIGH, 0, 0);
+	writeff("alpha.ff", ALPHAW, ALPHAH, 1, 0);
+	benchffload(t, "big.ff", "ffload", "");
+	benchffload(t, "alpha.ff", "ffload_alpha", NULL);
+	benchffrow(t);
+	benchffhuge();
+	benchffshared(t);
+	benchframes(t);
+	benchsoak();
+
+	/* decode the big image for a 1080p screen */
+	decodew = 1920;
+	decodeh = 1080;
+	benchffload(t, "big.ff", "ffload_capped", NULL);
+	decodew = decodeh = 0;
+
+	/* the same in 16 bit linear light, as with -L */
+	linear = 1;
+	benchffload(t, "big.ff", "ffload_linear", "_linear");
+	benchffload(t, "alpha.ff", "ffload_alpha_linear", NULL);
+	linear = 0;
+
+	sc = NULL;
+	benchtext(t);
+
+	free(t);
+	traceclose();
+	return 0;
+}
@@ -5,20 +5,73 @@ static char *fontfallbacks[] = {
 	"roboto",
 	"ubuntu",
 };
-#define NUMFONTSCALES 42
-#define FONTSZ(x) ((int)(10.0 * powf(1.1288, (x)))) /* x in [0, NUMFONTSCALES-1] */
+/* text is fitted to any pixel size between these two */
+#define MINFONTSIZE 13
+#define MAXFONTSIZE 1920
 
 static const char *colors[] = {
 	"#000000", /* foreground color */
 	"#FFFFFF", /* background color */
 };
 
+/* colors toggled to with i, a dark theme by default */
+static const char *altcolors[] = {
+	"#FFFFFF", /* foreground color */
+	"#000000", /* background color */
+};
+
 static const float linespacing = 1.4;
 
 /* how much screen estate is to be used at max for the content */
 static const float usablewidth = 0.75;
 static const float usableheight = 0.75;
 
+/* send images to the X server dithered to 16 bits per pixel at the size
+ * they are shown, for slow links; also enabled with -l */
+static const int lowbandwidth = 0;
+
+/* keep images at 16 bits per channel in linear light and scale them on
+ * the client, for smooth gradients at twice the memory; also enabled
+ * with -L */
+static const int linearlight = 0;
+
+/* frames per second of slides showing a directory of frames, and how
+ * many frames are kept decoded ahead of the one shown */
+static const float framerate = 30;
+static const unsigned int animbuffer = 60;
+
+/* transition when paging through the slides: TransNone, TransFade,
+ * TransSlide or TransWipe, taking transitiontime seconds */
+static const int transition = TransNone;
+static const float transitiontime = 0.3;
+
+/* number of thumbnails per row of the slide overview */
+static const int overviewcols = 5;
+
+/* images are shrunk while decoding by whole factors, but never below
+ * the size they take fitted into this multiple of the largest screen
+ * (or export size); 0 decodes them at full size */
+static const float maxdecodescale = 1.0;
+
+/* image filters: at most maxfilters run at once, each is killed after
+ * filtertimeout seconds (0 for never) and images wider or taller than
+ * maximageside or that decode to more than maximagepixels pixels are
+ * refused; failed images show their name */
+static const int maxfilters = 4;
+static const float filtertimeout = 10;
+static const unsigned int maximageside = 65535;
+static const unsigned long maximagepixels = 100000000;
+
+/* window sizes compiled decks (sent -c) store the font fits for */
+static const unsigned int compilesizes[][2] = {
+	{ 1920, 1080 },
+	{ 1280,  720 },
+	{ 1366,  768 },
+	{ 1024,  768 },
+	{ 1920, 1200 },
+	{ 3840, 2160 },
+};
+
 static Mousekey mshortcuts[] = {
 	/* button         function        argument */
 	{ Button1,        advance,        {.i = +1} },
@@ -47,6 +100,56 @@ static Shortcut shortcuts[] = {
 	{ XK_n,           advance,        {.i = +1} },
 	{ XK_p,           advance,        {.i = -1} },
 	{ XK_r,           reload,         {0} },
+	{ XK_o,           overview,       {0} },
+	{ XK_Tab,         overview,       {0} },
+	{ XK_slash,       search,         {0} },
+	{ XK_i,           theme,          {0} },
+	{ XK_s,           dumpstats,      {0} },
+};
+
+/* bindings while the slide overview is open */
+static Mousekey ovmshortcuts[] = {
+	/* button         function        argument */
+	{ Button1,        ovselect,       {0} },
+	{ Button3,        overview,       {0} },
+	{ Button4,        ovrow,          {.i = -1} },
+	{ Button5,        ovrow,          {.i = +1} },
+};
+
+static Shortcut ovshortcuts[] = {
+	/* keysym         function        argument */
+	{ XK_Escape,      overview,       {0} },
+	{ XK_o,           overview,       {0} },
+	{ XK_Tab,         overview,       {0} },
+	{ XK_Return,      overview,       {0} },
+	{ XK_q,           quit,           {0} },
+	{ XK_Right,       advance,        {.i = +1} },
+	{ XK_Left,        advance,        {.i = -1} },
+	{ XK_l,           advance,        {.i = +1} },
+	{ XK_h,           advance,        {.i = -1} },
+	{ XK_space,       advance,        {.i = +1} },
+	{ XK_BackSpace,   advance,        {.i = -1} },
+	{ XK_Down,        ovrow,          {.i = +1} },
+	{ XK_Up,          ovrow,          {.i = -1} },
+	{ XK_j,           ovrow,          {.i = +1} },
+	{ XK_k,           ovrow,          {.i = -1} },
+	{ XK_Next,        ovrow,          {.i = +3} },
+	{ XK_Prior,       ovrow,          {.i = -3} },
+	{ XK_r,           reload,         {0} },
+	{ XK_slash,       search,         {0} },
+	{ XK_i,           theme,          {0} },
+	{ XK_s,           dumpstats,      {0} },
+};
+
+/* bindings while typing a search, other keys extend the query */
+static Shortcut searchshortcuts[] = {
+	/* keysym         function        argument */
+	{ XK_Escape,      searchend,      {.i = 0} },
+	{ XK_Return,      searchend,      {.i = 1} },
+	{ XK_BackSpace,   searchdel,      {0} },
+	{ XK_Down,        searchnext,     {.i = +1} },
+	{ XK_Up,          searchnext,     {.i = -1} },
+	{ XK_Tab,         searchnext,     {.i = +1} },
 };
 
 static Filter filters[] = {
@@ -1,4 +1,5 @@
 /* See LICENSE file for copyright and license details. */
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -10,6 +11,7 @@
 
 #define UTF_INVALID 0xFFFD
 #define UTF_SIZ     4
+#define NOMATCHES   64 /* codepoints remembered to have no font */
 
 static const unsigned char utfbyte[UTF_SIZ + 1] = {0x80,    0, 0xC0, 0xE0, 0xF0};
 static const unsigned char utfmask[UTF_SIZ + 1] = {0xC0, 0x80, 0xE0, 0xF0, 0xF8};
@@ -60,6 +62,26 @@ utf8decode(const char *c, long *u, size_t clen)
 	return len;
 }
 
+/* length of the run of printable ASCII at the start of the n bytes at s */
+static size_t
+asciirun(const char *s, size_t n)
+{
+	const uint64_t ones = 0x0101010101010101ULL, high = ones * 0x80;
+	uint64_t v;
+	size_t i = 0;
+
+	/* eight bytes at a time: stop at a word holding a byte that has the
+	 * high bit set, is below 0x20 or is 0x7F */
+	for (; i + 8 <= n; i += 8) {
+		memcpy(&v, s + i, 8);
+		if ((v | ((v - ones * 0x20) & ~v) | ((v + ones) & ~v)) & high)
+			break;
+	}
+	for (; i < n && s[i] >= 0x20 && s[i] < 0x7F; i++)
+		;
+	return i;
+}
+
 Drw *
 drw_create(Display *dpy, int screen, Window root, unsigned int w, unsigned int h)
 {
@@ -107,6 +129,7 @@ xfont_create(Drw *drw, const char *fontname, FcPattern *fontpattern)
 	Fnt *font;
 	XftFont *xfont = NULL;
 	FcPattern *pattern = NULL;
+	FcChar32 c;
 
 	if (fontname) {
 		/* Using the pattern found at font->xfont->pattern does not yield the
@@ -137,6 +160,9 @@ xfont_create(Drw *drw, const char *fontname, FcPattern *fontpattern)
 	font->pattern = pattern;
 	font->h = xfont->ascent + xfont->descent;
 	font->dpy = drw->dpy;
+	for (c = 0x20; c < 0x7F && XftCharExists(drw->dpy, xfont, c); c++)
+		;
+	font->ascii = c == 0x7F;
 
 	return font;
 }
@@ -242,7 +268,8 @@ drw_text(Drw *drw, int x, int y, unsigned int w, unsigned int h, unsigned int lp
 	unsigned int ew;
 	XftDraw *d = NULL;
 	Fnt *usedfont, *curfont, *nextfont;
-	size_t i, len;
+	size_t i, len, n;
+	const char *end;
 	int utf8charlen, render = x || y || w || h;
 	long utf8codepoint = 0;
 	FcCharSet *fccharset;
@@ -250,6 +277,11 @@ drw_text(Drw *drw, int x, int y, unsigned int w, unsigned int h, unsigned int lp
 	FcPattern *match;
 	XftResult result;
 	int charexists = 0;
+	/* no font has these, so fontconfig is not asked again on every draw */
+	static struct {
+		long codepoint[NOMATCHES];
+		unsigned int idx;
+	} nomatches;
 
 	if (!drw || (render && !drw->scheme) || !text || !drw->fonts)
 		return 0;
@@ -267,11 +299,20 @@ drw_text(Drw *drw, int x, int y, unsigned int w, unsigned int h, unsigned int lp
 	}
 
 	usedfont = drw->fonts;
+	end = text + strlen(text);
 	while (1) {
 		int utf8strlen = 0;
 		const char* utf8str = text;
 		nextfont = NULL;
 		while (*text) {
+			/* plain ASCII needs neither decoding nor a font lookup when
+			 * the first font covers it */
+			if (usedfont == drw->fonts && usedfont->ascii &&
+			    (n = asciirun(text, end - text))) {
+				utf8strlen += n;
+				text += n;
+				continue;
+			}
 			utf8charlen = utf8decode(text, &utf8codepoint, UTF_SIZ);
 			for (curfont = drw->fonts; curfont; curfont = curfont->next) {
 				charexists = charexists || XftCharExists(drw->dpy, curfont->xfont, utf8codepoint);
@@ -325,6 +366,15 @@ drw_text(Drw *drw, int x, int y, unsigned int w, unsigned int h, unsigned int lp
 			 * character must be drawn. */
 			charexists = 1;
 
+			for (i = 0; i < NOMATCHES; i++) {
+				if (nomatches.codepoint[i] == utf8codepoint) {
+					usedfont = drw->fonts;
+					break;
+				}
+			}
+			if (i < NOMATCHES)
+				continue;
+
 			fccharset = FcCharSetCreate();
 			FcCharSetAddChar(fccharset, utf8codepoint);
 
@@ -351,7 +401,11 @@ drw_text(Drw *drw, int x, int y, unsigned int w, unsigned int h, unsigned int lp
 						; /* NOP */
 					curfont->next = usedfont;
 				} else {
+					/* the font owns match only once it is open */
+					if (!usedfont)
+						FcPatternDestroy(match);
 					xfont_free(usedfont);
+					nomatches.codepoint[nomatches.idx++ % NOMATCHES] = utf8codepoint;
 					usedfont = drw->fonts;
 				}
 			}
@@ -369,8 +423,9 @@ drw_map(Drw *drw, Window win, int x, int y, unsigned int w, unsigned int h)
 	if (!drw)
 		return;
 
+	/* no XSync(): the copy goes out with the next flush and waiting
+	 * for the server here would cost a round-trip per frame */
 	XCopyArea(drw->dpy, drw->drawable, win, drw->gc, x, y, w, h, x, y);
-	XSync(drw->dpy, False);
 }
 
 unsigned int
@@ -9,6 +9,7 @@ typedef struct Fnt {
 	unsigned int h;
 	XftFont *xfont;
 	FcPattern *pattern;
+	int ascii;  /* has a glyph for all of printable ASCII */
 	struct Fnt *next;
 } Fnt;
 
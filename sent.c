@@ -1,16 +1,26 @@
 /* See LICENSE file for copyright and license details. */
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/un.h>
+#include <sys/wait.h>
 #include <arpa/inet.h>
 
+#include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <math.h>
+#include <poll.h>
 #include <regex.h>
+#include <signal.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 #include <X11/keysym.h>
 #include <X11/XKBlib.h>
@@ -18,10 +28,12 @@
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
 #include <X11/Xft/Xft.h>
+#include <X11/extensions/Xrender.h>
 
 #include "arg.h"
 #include "util.h"
 #include "drw.h"
+#include "trace.h"
 
 char *argv0;
 
@@ -29,18 +41,60 @@ char *argv0;
 #define LEN(a)         (sizeof(a) / sizeof(a)[0])
 #define LIMIT(x, a, b) (x) = (x) < (a) ? (a) : (x) > (b) ? (b) : (x)
 #define MAXFONTSTRLEN  128
+#define REFFONTSIZE    100  /* pixel size slides are measured at */
+#define NUMFONTS       16   /* font sizes kept open */
+#define NUMTHUMBFONTS  4    /* and for thumbnails, apart from those */
+#define FONTSTEP       1.03 /* ratio of the font sizes text is fitted to */
+#define THUMBFONTSTEP  1.25 /* the same for thumbnails */
+#define NUMMIPS        12 /* halvings kept per image */
+#define MIPMIN         32 /* no halvings smaller than this are built */
+#define MIPBAND        64 /* rows built per idle turn */
+#define INDEXBATCH     1024 /* slides indexed per idle turn */
+#define MAXPICTSIZE    8192 /* larger images are scaled on the client */
+#define MAXCLIENTS     8    /* connections to the control socket */
+
+#define BINMAGIC       "sentdeck"
+#define BINVERSION     3
+#define BINENDIAN      0x01020304
 
 typedef enum {
 	NONE = 0,
 	SCALED = 1,
+	MAPPED = 2, /* buf points into a compiled deck */
+	QUEUED = 4, /* waiting for a filter to run */
+	DECODING = 8,
+	FAILED = 16, /* drawn as a placeholder */
 } imgstate;
 
-typedef struct {
+enum { TransNone, TransFade, TransSlide, TransWipe }; /* slide transitions */
+enum { MemDecoded, MemMips, MemScaled, MemServer, MemLast }; /* image memory */
+
+/* pixels are kept as premultiplied RGBA, so the background is only
+ * blended in when drawing; 8 bits per channel in sRGB, or 16 in linear
+ * light with -L */
+typedef struct Image {
 	unsigned char *buf;
 	unsigned int bufwidth, bufheight;
+	int linear;         /* buf and mip hold 16 bit linear light */
 	imgstate state;
 	XImage *ximg;
+	unsigned long ximgbg; /* background pixel ximg was composited on */
+	Pixmap pix;         /* buf uploaded for scaling on the server */
+	Picture pic;
+	int picw, pich;     /* size the transform of pic scales to */
+	int picfixed;       /* pic is already scaled to picw x pich */
 	int numpasses;
+	unsigned char *mip[NUMMIPS]; /* successive halvings of buf */
+	unsigned int mipw[NUMMIPS], miph[NUMMIPS];
+	int nmips, mipsdone;
+	unsigned int miprow; /* rows done of the halving being built */
+	unsigned int refs;  /* slides sharing this image */
+	char *path;         /* canonical path of the source file */
+	const char *bin;    /* filter converting it to farbfeld */
+	struct Image *qnext; /* next image queued for decoding */
+	uint64_t hash;      /* hash and size of the source file's content */
+	off_t size;
+	struct Image *next; /* next image in the store */
 } Image;
 
 typedef struct {
@@ -48,18 +102,84 @@ typedef struct {
 	char *bin;
 } Filter;
 
+/* a running filter and the decoding of its output */
+typedef struct {
+	Image *img;         /* NULL if the slot is free */
+	pid_t pid;
+	int fd;
+	double deadline;    /* monotonic time it is killed at, or 0 */
+	double start;
+	double began;       /* monotonic start time for the stats */
+	unsigned char hdr[16];
+	size_t hdrlen;
+	uint32_t width, height, y;
+	uint32_t fx, fy;    /* source pixels per decoded pixel across, down */
+	uint16_t *row;      /* the row being read */
+	size_t rowlen, nbytes;
+	uint64_t *acc;      /* box sums of the band, NULL if fx = fy = 1 */
+	double boxhalf, boxinv; /* rounding and reciprocal of the box area */
+} Job;
+
+/* a connection to the control socket */
+typedef struct {
+	int fd;             /* -1 if the slot is free */
+	char buf[256];      /* the line being read */
+	size_t len;
+} Client;
+
 typedef struct {
 	unsigned int linecount;
 	char **lines;
-	Image *img;
+	Image *img;      /* the frame shown of an animated slide */
 	char *embed;
+	Image **frames;  /* frames of a directory, in the order of their names */
+	unsigned int nframes, frame;
+	char *text;      /* search index: folded lines joined by newlines */
+	size_t textlen;
+	uint64_t mask;   /* bytes occurring in text, modulo 64 */
+	unsigned int refw; /* widest line at REFFONTSIZE, 0 if not measured */
 } Slide;
 
+/* Compiled deck file layout; all offsets are from the start of the file
+ * and all values are in the byte order of the machine that wrote it. */
+typedef struct {
+	char magic[8];
+	uint32_t version;
+	uint32_t endian;
+	uint32_t slidecount, linecount, imagecount, fitcount;
+	uint32_t fontkey;  /* configuration the font fits were measured with */
+	uint32_t reserved; /* 0 */
+	uint64_t slideoff; /* BinSlide[slidecount] */
+	uint64_t lineoff;  /* uint64_t[linecount], offsets of each line */
+	uint64_t imageoff; /* BinImage[imagecount] */
+	uint64_t fitoff;   /* BinFit[fitcount] */
+} BinHeader;
+
+typedef struct {
+	uint32_t firstline, linecount;
+	int32_t image;     /* index into the image table or -1 */
+	uint32_t embed;    /* image slide, the path follows the @ of line 0 */
+} BinSlide;
+
+typedef struct {
+	uint32_t width, height;
+	uint64_t off;      /* width * height premultiplied RGBA pixels */
+} BinImage;
+
+typedef struct {
+	uint32_t uw, uh;   /* usable window size the fits apply to */
+	uint64_t off;      /* BinFitSlide[slidecount] */
+} BinFit;
+
+typedef struct {
+	uint32_t font, width; /* pixel size of the font, widest line */
+} BinFitSlide;
+
 /* Purely graphic info */
 typedef struct {
 	Display *dpy;
 	Window win;
-	Atom wmdeletewin, netwmname;
+	Atom wmdeletewin, netwmname, sentframe;
 	Visual *vis;
 	XSetWindowAttributes attrs;
 	int scr;
@@ -87,23 +207,57 @@ typedef struct {
 } Shortcut;
 
 static void fffree(Image *img);
+static void ffunqueue(Image *img);
+static void jobclose(Job *j);
 static void ffload(Slide *s);
+static void ffwait(void);
 static void ffprepare(Image *img);
+static int ffmipmap(Image *img);
 static void ffscale(Image *img);
+static void ffscaleto(Image *img, XImage *ximg);
 static void ffdraw(Image *img);
+static void ffwrite(FILE *fp);
 
 static void getfontsize(Slide *s, unsigned int *width, unsigned int *height);
 static void cleanup(int slidesonly);
 static void reload(const Arg *arg);
 static void load(FILE *fp);
+static void loadbin(char *data, size_t len);
+static Image *binimage(Slide *s);
+static void compile(const char *path);
+static void readstream(void);
 static void advance(const Arg *arg);
+static int indexslides(int max);
+static int searchupdate(int narrow);
+static void search(const Arg *arg);
+static void searchend(const Arg *arg);
+static void searchnext(const Arg *arg);
+static void searchdel(const Arg *arg);
+static void overview(const Arg *arg);
+static void ovrow(const Arg *arg);
+static void ovselect(const Arg *arg);
+static void theme(const Arg *arg);
+static void dumpstats(const Arg *arg);
+static void export(void);
+static void exportslides(int job);
 static void quit(const Arg *arg);
 static void resize(int width, int height);
 static void run();
 static void usage();
 static void xdraw();
+static void xframe();
+static void xdrawslide(Slide *s);
+static void transbegin(int kind, int to);
+static void transend(void);
+static void transdraw(void);
+static void ctlclose(void);
+static void ovdraw(void);
+static void searchdraw(void);
+static void ovfree(void);
+static int ovidle(void);
 static void xhints();
 static void xinit();
+static void xinitdrw(Window root);
 static void xloadfonts();
 
 static void bpress(XEvent *);
@@ -111,6 +265,7 @@ static void cmessage(XEvent *);
 static void expose(XEvent *);
 static void kpress(XEvent *);
 static void configure(XEvent *);
+static void pnotify(XEvent *);
 
 /* config.h for applying patches and the configuration. */
 #include "config.h"
@@ -120,11 +275,113 @@ static const char *fname = NULL;
 static Slide *slides = NULL;
 static int idx = 0;
 static int slidecount = 0;
+static size_t slidecap = 0;
+static Arena deck;              /* everything parsed from the current deck */
+static int streamfd = -1;       /* input still being read while presenting */
+static char *deckbin = NULL;    /* compiled deck the slides point into */
+static size_t deckbinlen = 0;
+static const BinHeader *binhdr = NULL;
+static Image **binimgs = NULL;  /* shared images of the compiled deck */
+static Image *images = NULL;    /* decoded images, shared between slides */
+static Image *queue = NULL;     /* images waiting for a filter */
+static Image **queuetail = &queue;
+static Job *jobs = NULL;        /* maxfilters slots */
+static int njobs = 0;
+static int jobsrunning = 0;
+static int mipslide = 0;        /* first slide that may need mip levels */
+static int decodew = 0;         /* size decoded images are capped against */
+static int decodeh = 0;
+static int busy = 1;            /* deferred work may be pending */
+static float kiosk = 0;         /* seconds each slide is shown for, or 0 */
+static int kioskidx = -1;       /* slide the kiosk timer was started on */
+static double kiosknext = 0;    /* monotonic time of the next advance */
+static int animslide = -1;      /* slide the animation state belongs to */
+static double animnext = 0;     /* monotonic time the next frame is due */
+static int ptrx, ptry;          /* pointer position of the last button press */
+
+/* slide overview */
+static int ovopen = 0;
+static int ovtop = 0;           /* first visible row */
+static Pixmap *thumbs = NULL;   /* cached thumbnail of each slide or None */
+static int thumbcount = 0;
+static int thumbw = 0, thumbh = 0;
+
+/* incremental search */
+static int searching = 0;
+static int searchfrom = 0;      /* slide the search started on */
+static char query[128];
+static size_t querylen = 0;
+static int *matches = NULL;     /* slides containing query, ascending */
+static size_t *matchoffs = NULL; /* offset of the first match in each */
+static int nmatches = 0;
+static int matchcap = 0;
+static int matchedto = 0;       /* slides matches was computed over */
+static int indexed = 0;         /* slides indexed so far */
+static regex_t filterres[LEN(filters)];
+static int filterok[LEN(filters)];
+static int filtersready = 0;
+static XRenderPictFormat *imgfmt = NULL; /* set if XRender can scale */
+static XRenderPictFormat *winfmt = NULL;
+static XRenderPictFormat *lowfmt = NULL; /* RGB565 for low bandwidth mode */
+static int lowbw = 0;
+static int linear = 0;          /* decode to linear light */
+static uint16_t tolinear[65536]; /* 16 bit sRGB to linear light */
+static unsigned char tosrgb[4096]; /* linear light >> 4 to 8 bit sRGB */
 static XWindow xw;
 static Drw *d = NULL;
 static Clr *sc;
-static Fnt *fonts[NUMFONTSCALES];
+static Clr *altsc;              /* the colors theme() switches to */
+/* open font sizes, the least recently used one makes way for a new one;
+ * the last NUMTHUMBFONTS are for thumbnails, so that the grid does not
+ * push out the sizes of the presentation */
+static struct {
+	int size;       /* pixels, 0 if the slot is free */
+	Fnt *set;
+	unsigned int base; /* fonts in set before any fallback */
+	unsigned long used;
+} fonts[NUMFONTS + NUMTHUMBFONTS];
+static unsigned long fontclock = 0;
+static int refh;             /* font height at REFFONTSIZE */
+static int fontthumb = 0;    /* text is fitted to a thumbnail */
 static int running = 1;
+static double inputtime = 0; /* trace timestamp of the first input event
+                                not drawn yet */
+static double frameinput = 0; /* that of the frame in flight */
+static double frametime = 0;
+static int dirty = 0;        /* the window needs to be drawn again */
+
+/* slide transition: the frame shown last and the first one of the slide
+ * transidx are blended over transitiontime seconds */
+static int transkind = TransNone;
+static int transdir;         /* 1 forward, -1 backward */
+static int transidx;
+static int transw, transh;
+static double transstart;
+static Pixmap transfrom = None;
+static Pixmap transto = None;
+static Picture transtopic = None;
+static int inflight = 0;     /* a frame has not been acknowledged yet */
+
+/* counters for the stats dump */
+static struct {
+	unsigned long imghits, imgmisses; /* decodes shared by ffopen() */
+	unsigned long fithits, fitmisses; /* font fits from a compiled deck */
+	unsigned long fonthits, fontmisses; /* font sizes already open */
+	unsigned long decodes, scales, uploads;
+	double decodetime, scaletime, uploadtime;
+} stats;
+static volatile sig_atomic_t statsreq = 0; /* set by SIGUSR1 */
+
+/* control socket */
+static const char *ctlpath = NULL;
+static int ctlfd = -1;
+static Client clients[MAXCLIENTS];
+
+/* compile and export mode */
+static const char *compileout = NULL;
+static const char *exportdir = NULL;
+static int exportw = 1920, exporth = 1080;
+static int exportjobs = 0;
 
 static void (*handler[LASTEvent])(XEvent *) = {
 	[ButtonPress] = bpress,
@@ -132,20 +389,34 @@ static void (*handler[LASTEvent])(XEvent *) = {
 	[ConfigureNotify] = configure,
 	[Expose] = expose,
 	[KeyPress] = kpress,
+	[PropertyNotify] = pnotify,
 };
 
-int
-filter(int fd, const char *cmd)
+/* index of s for tracing, or -1 if it is not part of the deck */
+static int
+slideidx(Slide *s)
+{
+	return (slides && s >= slides && s < slides + slidecount) ? s - slides : -1;
+}
+
+/* run cmd with fd as its input in a process group of its own, so that
+ * a hung pipeline can be killed as a whole; returns the non-blocking
+ * read end of its output */
+static int
+filter(int fd, const char *cmd, pid_t *pid)
 {
 	int fds[2];
 
 	if (pipe(fds) < 0)
-		die("sent: Unable to create pipe:");
+		return -1;
 
-	switch (fork()) {
+	switch ((*pid = fork())) {
 	case -1:
-		die("sent: Unable to fork:");
+		close(fds[0]);
+		close(fds[1]);
+		return -1;
 	case 0:
+		setpgid(0, 0);
 		dup2(fd, 0);
 		dup2(fds[1], 1);
 		close(fds[0]);
@@ -154,423 +425,3240 @@ filter(int fd, const char *cmd)
 		fprintf(stderr, "sent: execlp sh -c '%s': %s\n", cmd, strerror(errno));
 		_exit(1);
 	}
+	setpgid(*pid, *pid);
 	close(fds[1]);
+	fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+	fcntl(fds[0], F_SETFL, O_NONBLOCK);
 	return fds[0];
 }
 
+static void
+ximgdestroy(XImage *ximg)
+{
+	poolput(ximg->data, ximg->bytes_per_line * ximg->height);
+	ximg->data = NULL;
+	XDestroyImage(ximg);
+}
+
+static void
+ximgfree(Image *img)
+{
+	if (!img->ximg)
+		return;
+	ximgdestroy(img->ximg);
+	img->ximg = NULL;
+}
+
+/* bytes per pixel of the buffers of img */
+static size_t
+bufbpp(Image *img)
+{
+	return img->linear ? 8 : 4;
+}
+
+/* fill the tables between sRGB and linear light */
+static void
+lininit(void)
+{
+	static int done = 0;
+	unsigned int i;
+	float c;
+
+	if (done)
+		return;
+	for (i = 0; i < LEN(tolinear); i++) {
+		c = i / 65535.0;
+		c = c <= 0.04045 ? c / 12.92 : powf((c + 0.055) / 1.055, 2.4);
+		tolinear[i] = c * 65535 + 0.5;
+	}
+	for (i = 0; i < LEN(tosrgb); i++) {
+		c = (i + 0.5) / LEN(tosrgb);
+		c = c <= 0.0031308 ? c * 12.92 : 1.055 * powf(c, 1 / 2.4) - 0.055;
+		tosrgb[i] = c * 255 + 0.5;
+	}
+	done = 1;
+}
+
+static void
+fffreepic(Image *img)
+{
+	if (!img->pic)
+		return;
+	XRenderFreePicture(xw.dpy, img->pic);
+	XFreePixmap(xw.dpy, img->pix);
+	img->pic = None;
+	img->pix = None;
+}
+
+/* release the pixels of img and everything made from them; it is
+ * decoded again once it is queued */
+static void
+ffevict(Image *img)
+{
+	int i;
+
+	if (img->state & QUEUED)
+		ffunqueue(img);
+	for (i = 0; i < njobs; i++)
+		if (jobs[i].img == img)
+			jobclose(&jobs[i]);
+	img->state &= ~(DECODING | SCALED);
+	if (!(img->state & MAPPED))
+		poolput(img->buf, img->bufwidth * img->bufheight * bufbpp(img));
+	img->buf = NULL;
+	if (img->miprow)
+		poolput(img->mip[img->nmips], img->mipw[img->nmips] *
+		        img->miph[img->nmips] * bufbpp(img));
+	img->miprow = 0;
+	for (; img->nmips > 0; img->nmips--)
+		poolput(img->mip[img->nmips - 1], img->mipw[img->nmips - 1] *
+		        img->miph[img->nmips - 1] * bufbpp(img));
+	img->mipsdone = 0;
+	ximgfree(img);
+	fffreepic(img);
+}
+
+/* drop one reference; the Image itself belongs to the deck arena, so
+ * only its buffers go back once the last slide lets go of it */
 void
 fffree(Image *img)
 {
-	free(img->buf);
-	if (img->ximg)
-		XDestroyImage(img->ximg);
-	free(img);
+	Image **ip;
+
+	if (img->refs && --img->refs)
+		return;
+	for (ip = &images; *ip; ip = &(*ip)->next) {
+		if (*ip == img) {
+			*ip = img->next;
+			break;
+		}
+	}
+	ffevict(img);
+}
+
+/* let go of the image of s, or of all its frames */
+static void
+fffreeslide(Slide *s)
+{
+	unsigned int i;
+
+	if (s->nframes) {
+		for (i = 0; i < s->nframes; i++)
+			fffree(s->frames[i]);
+	} else if (s->img) {
+		fffree(s->img);
+	}
+	s->img = NULL;
+	s->frames = NULL;
+	s->nframes = s->frame = 0;
+}
+
+/* compile the filter regexes once */
+static const char *
+findfilter(const char *filename)
+{
+	size_t i;
+
+	if (!filtersready) {
+		for (i = 0; i < LEN(filters); i++) {
+			filterok[i] = !regcomp(&filterres[i], filters[i].regex,
+			                       REG_NOSUB | REG_EXTENDED | REG_ICASE);
+			if (!filterok[i])
+				fprintf(stderr, "sent: Invalid regex '%s'\n", filters[i].regex);
+		}
+		filtersready = 1;
+	}
+	for (i = 0; i < LEN(filters); i++)
+		if (filterok[i] && !regexec(&filterres[i], filename, 0, NULL, 0))
+			return filters[i].bin;
+	return NULL;
+}
+
+/* FNV-1a over the content of a regular file, a word at a time */
+static int
+filehash(int fd, uint64_t *hash, off_t *size)
+{
+	struct stat st;
+	unsigned char *p;
+	uint64_t h = 14695981039346656037u, w;
+	off_t i;
+
+	if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) || !st.st_size)
+		return -1;
+	if ((p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED)
+		return -1;
+	for (i = 0; i + 8 <= st.st_size; i += 8) {
+		memcpy(&w, p + i, 8);
+		h = (h ^ w) * 1099511628211u;
+	}
+	for (; i < st.st_size; i++)
+		h = (h ^ p[i]) * 1099511628211u;
+	munmap(p, st.st_size);
+	*hash = h;
+	*size = st.st_size;
+	return 0;
+}
+
+/* whether the files at a and b both still have size bytes and the same
+ * content; hashes alone may collide */
+static int
+samecontent(const char *a, const char *b, off_t size)
+{
+	const char *path[2] = { a, b };
+	void *p[2] = { MAP_FAILED, MAP_FAILED };
+	struct stat st;
+	int i, fd, same;
+
+	for (i = 0; i < 2; i++) {
+		if ((fd = open(path[i], O_RDONLY)) < 0)
+			break;
+		if (!fstat(fd, &st) && st.st_size == size)
+			p[i] = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+	}
+	same = p[0] != MAP_FAILED && p[1] != MAP_FAILED &&
+	       !memcmp(p[0], p[1], size);
+	for (i = 0; i < 2; i++)
+		if (p[i] != MAP_FAILED)
+			munmap(p[i], size);
+	return same;
+}
+
+static Image *
+imageref(Image *img)
+{
+	img->refs++;
+	return img;
+}
+
+static double
+monotime(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* whether img is decoded completely and can be drawn */
+static int
+ffready(Image *img)
+{
+	return img->buf && !(img->state & DECODING);
+}
+
+/* a decode finished one way or the other: the slides showing img may
+ * look different now */
+static void
+ffchanged(Image *img)
+{
+	int i;
+
+	for (i = 0; i < thumbcount && i < slidecount; i++) {
+		if (slides[i].img == img && thumbs[i]) {
+			XFreePixmap(xw.dpy, thumbs[i]);
+			thumbs[i] = None;
+		}
+	}
+	mipslide = 0;
+	/* frames decoded ahead are not seen yet */
+	if (ovopen || (slidecount && slides[idx].img == img))
+		xdraw();
+}
+
+/* give up on img, it is drawn as a placeholder from now on */
+static void
+fffail(Image *img, const char *why)
+{
+	fprintf(stderr, "sent: Unable to load '%s': %s\n", img->path, why);
+	if (img->buf)
+		poolput(img->buf, img->bufwidth * img->bufheight * bufbpp(img));
+	img->buf = NULL;
+	img->state = (img->state & ~(QUEUED | DECODING)) | FAILED;
+	ffchanged(img);
+}
+
+/* image that failed before it could be queued */
+static Image *
+ffbroken(const char *filename, const char *why)
+{
+	Image *img = arenaalloc(&deck, sizeof(*img));
+
+	memset(img, 0, sizeof(*img));
+	img->refs = 1;
+	img->path = arenaalloc(&deck, strlen(filename) + 1);
+	strcpy(img->path, filename);
+	fffail(img, why);
+	return img;
 }
 
 void
-ffload(Slide *s)
+ffunqueue(Image *img)
 {
-	uint32_t y, x;
-	uint16_t *row;
-	uint8_t opac, fg_r, fg_g, fg_b, bg_r, bg_g, bg_b;
-	size_t rowlen, off, i;
+	Image **ip;
+
+	for (ip = &queue; *ip; ip = &(*ip)->qnext) {
+		if (*ip == img) {
+			if (!(*ip = img->qnext))
+				queuetail = ip;
+			break;
+		}
+	}
+	img->qnext = NULL;
+	img->state &= ~QUEUED;
+}
+
+/* stop the filter of j, reap it and release the scratch buffers */
+void
+jobclose(Job *j)
+{
+	close(j->fd);
+	/* the output is complete or of no interest anymore either way */
+	kill(-j->pid, SIGKILL);
+	while (waitpid(j->pid, NULL, 0) < 0 && errno == EINTR)
+		;
+	poolput(j->row, j->rowlen);
+	free(j->acc);
+	memset(j, 0, sizeof(*j));
+	jobsrunning--;
+}
+
+static void
+jobfail(Job *j, const char *why)
+{
+	Image *img = j->img;
+
+	jobclose(j);
+	fffail(img, why);
+}
+
+/* start the filter of the next queued image, the current slide's first */
+static void
+jobstart(Job *j)
+{
+	Image *img = queue;
+	int fd;
+
+	if (slidecount && idx < slidecount && slides[idx].img &&
+	    slides[idx].img->state & QUEUED)
+		img = slides[idx].img;
+	ffunqueue(img);
+
+	if ((fd = open(img->path, O_RDONLY)) < 0) {
+		fffail(img, strerror(errno));
+		return;
+	}
+	j->fd = filter(fd, img->bin, &j->pid);
+	close(fd);
+	if (j->fd < 0) {
+		fffail(img, strerror(errno));
+		return;
+	}
+	img->state |= DECODING;
+	j->img = img;
+	j->deadline = filtertimeout > 0 ? monotime() + filtertimeout : 0;
+	TRACEBEGIN(j->start);
+	j->began = monotime();
+	jobsrunning++;
+}
+
+/* set up decoding once the farbfeld header has arrived */
+static int
+jobheader(Job *j)
+{
+	Image *img = j->img;
+	uint32_t capw, caph, f;
+	uint64_t area;
+
+	if (memcmp("farbfeld", j->hdr, 8)) {
+		jobfail(j, "filter output has no valid farbfeld header");
+		return 0;
+	}
+	j->width = ntohl(*(uint32_t *)&j->hdr[8]);
+	j->height = ntohl(*(uint32_t *)&j->hdr[12]);
+	if (!j->width || !j->height) {
+		jobfail(j, "image is empty");
+		return 0;
+	}
+	/* rows are read whole and scratch is sized by the sides, so both
+	 * are bounded before anything is allocated */
+	if (j->width > maximageside || j->height > maximageside) {
+		jobfail(j, "image is too large");
+		return 0;
+	}
+	TRACEEND("filter", j->start, -1);
+
+	/* shrink images far larger than the screen by an integer factor
+	 * while decoding, so memory is bounded by the decoded size; the
+	 * largest factor that still leaves the image fitted into the cap
+	 * at no less than its shown size */
+	f = 1;
+	if (maxdecodescale > 0 && decodew > 0 && decodeh > 0) {
+		capw = MAX(1, maxdecodescale * decodew);
+		caph = MAX(1, maxdecodescale * decodeh);
+		f = MAX(j->width / capw, j->height / caph);
+		f = MAX(f, 1);
+	}
+	/* a side shorter than f is not shrunk, so every box is whole */
+	j->fx = MIN(f, j->width);
+	j->fy = MIN(f, j->height);
+	img->bufwidth = j->width / j->fx;
+	img->bufheight = j->height / j->fy;
+	if ((uint64_t)img->bufwidth * img->bufheight > maximagepixels) {
+		jobfail(j, "image has too many pixels");
+		return 0;
+	}
+
+	if ((img->linear = linear))
+		lininit();
+	img->buf = poolget(img->bufwidth * img->bufheight * bufbpp(img));
+
+	/* scratch buffer to read row by row */
+	j->rowlen = j->width * 2 * strlen("RGBA");
+	j->row = poolget(j->rowlen);
+	if (j->fx > 1 || j->fy > 1) {
+		j->acc = ecalloc(img->bufwidth * 4, sizeof(*j->acc));
+		/* premultiplying is only divided out of the box sums, and
+		 * those are rounded to nearest by a multiplication; the
+		 * extra half keeps quotients at least 0.5 / area away from
+		 * a whole number, far more than a double can be off by */
+		area = (uint64_t)j->fx * j->fy * (img->linear ? 1 : 255);
+		j->boxhalf = area / 2 + 0.5;
+		j->boxinv = 1.0 / area;
+	}
+	return 1;
+}
+
+/* convert the row just read to linear light, keeping all 16 bits */
+static void
+jobrowlinear(Job *j)
+{
+	Image *img = j->img;
+	uint32_t x, y = j->y, fx = j->fx, fy = j->fy, k, a;
+	uint32_t r, g, b, sa;
+	uint16_t *row = j->row, *dst;
+	uint64_t *acc;
+
+	if (!j->acc) {
+		dst = (uint16_t *)img->buf + (size_t)y * j->width * 4;
+		for (x = 0; x < j->rowlen / 2; x += 4) {
+			a = ntohs(row[x + 3]);
+			dst[x + 0] = (tolinear[ntohs(row[x + 0])] * a + 32767) / 65535;
+			dst[x + 1] = (tolinear[ntohs(row[x + 1])] * a + 32767) / 65535;
+			dst[x + 2] = (tolinear[ntohs(row[x + 2])] * a + 32767) / 65535;
+			dst[x + 3] = a;
+		}
+		return;
+	}
+
+	/* boxes are averaged in linear light, as in jobrow() */
+	for (x = 0, acc = j->acc; x < img->bufwidth; x++, acc += 4) {
+		for (k = r = g = b = sa = 0; k < fx; k++, row += 4) {
+			a = ntohs(row[3]);
+			r += (tolinear[ntohs(row[0])] * a + 32767) / 65535;
+			g += (tolinear[ntohs(row[1])] * a + 32767) / 65535;
+			b += (tolinear[ntohs(row[2])] * a + 32767) / 65535;
+			sa += a;
+		}
+		acc[0] += r;
+		acc[1] += g;
+		acc[2] += b;
+		acc[3] += sa;
+	}
+	if (y % fy == fy - 1) {
+		dst = (uint16_t *)img->buf + (size_t)y / fy * img->bufwidth * 4;
+		for (x = 0; x < img->bufwidth * 4; x++) {
+			dst[x] = (j->acc[x] + j->boxhalf) * j->boxinv;
+			j->acc[x] = 0;
+		}
+	}
+}
+
+/* convert the row just read */
+static void
+jobrow(Job *j)
+{
+	Image *img = j->img;
+	uint32_t x, y = j->y, fx = j->fx, fy = j->fy, k;
+	uint32_t r, g, b, a;
+	uint16_t *row = j->row;
+	uint8_t opac;
+	unsigned char *dst;
+	uint64_t *acc;
+	size_t off;
+
+	/* rows past the last whole band are read, but dropped */
+	if (y / fy >= img->bufheight)
+		return;
+	if (img->linear) {
+		jobrowlinear(j);
+		return;
+	}
+
+	if (!j->acc) {
+		dst = &img->buf[y * j->width * 4];
+		for (off = 0, x = 0; x < j->rowlen / 2; x += 4) {
+			opac = ntohs(row[x + 3]) / 257;
+			dst[off++] = (ntohs(row[x + 0]) / 257 * opac + 127) / 255;
+			dst[off++] = (ntohs(row[x + 1]) / 257 * opac + 127) / 255;
+			dst[off++] = (ntohs(row[x + 2]) / 257 * opac + 127) / 255;
+			dst[off++] = opac;
+		}
+		return;
+	}
+
+	/* convert and sum up fx x fy boxes in one pass and emit a row once
+	 * the band is complete; premultiplied pixels average without
+	 * weighting by alpha, alpha is scaled to match the colours */
+	for (x = 0, acc = j->acc; x < img->bufwidth; x++, acc += 4) {
+		for (k = r = g = b = a = 0; k < fx; k++, row += 4) {
+			opac = ntohs(row[3]) / 257;
+			r += ntohs(row[0]) / 257 * opac;
+			g += ntohs(row[1]) / 257 * opac;
+			b += ntohs(row[2]) / 257 * opac;
+			a += opac * 255;
+		}
+		acc[0] += r;
+		acc[1] += g;
+		acc[2] += b;
+		acc[3] += a;
+	}
+	if (y % fy == fy - 1) {
+		dst = &img->buf[y / fy * img->bufwidth * 4];
+		for (x = 0; x < img->bufwidth * 4; x++) {
+			dst[x] = (j->acc[x] + j->boxhalf) * j->boxinv;
+			j->acc[x] = 0;
+		}
+	}
+}
+
+/* decode whatever the filter of j has written so far */
+static void
+jobread(Job *j)
+{
+	Image *img;
 	ssize_t count;
-	unsigned char hdr[16];
-	char *bin = NULL;
-	char *filename;
-	regex_t regex;
-	int fdin, fdout;
 
-	if (s->img || !(filename = s->embed) || !s->embed[0])
-		return; /* already done */
+	while (1) {
+		if (j->hdrlen < sizeof(j->hdr))
+			count = read(j->fd, j->hdr + j->hdrlen, sizeof(j->hdr) - j->hdrlen);
+		else
+			count = read(j->fd, (char *)j->row + j->nbytes, j->rowlen - j->nbytes);
+		if (count < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno != EAGAIN)
+				jobfail(j, strerror(errno));
+			return;
+		}
+		if (!count) {
+			jobfail(j, "filter output ended early");
+			return;
+		}
+		if (j->hdrlen < sizeof(j->hdr)) {
+			if ((j->hdrlen += count) == sizeof(j->hdr) && !jobheader(j))
+				return;
+			continue;
+		}
+		if ((j->nbytes += count) < j->rowlen)
+			continue;
+		jobrow(j);
+		j->nbytes = 0;
+		if (++j->y == j->height) {
+			img = j->img;
+			TRACEEND("decode", j->start, -1);
+			stats.decodes++;
+			stats.decodetime += monotime() - j->began;
+			jobclose(j);
+			img->state &= ~DECODING;
+			ffchanged(img);
+			return;
+		}
+	}
+}
+
+/* poll descriptors of the running filters, returning their number */
+static int
+ffpollfds(struct pollfd *pfd)
+{
+	int i, n = 0;
+
+	for (i = 0; i < njobs; i++) {
+		if (jobs[i].img) {
+			pfd[n].fd = jobs[i].fd;
+			pfd[n++].events = POLLIN;
+		}
+	}
+	return n;
+}
+
+/* milliseconds until the first filter runs out of time, or -1 */
+static int
+fftimeout(void)
+{
+	double dt, min = -1;
+	int i;
+
+	for (i = 0; i < njobs; i++) {
+		if (!jobs[i].img || !jobs[i].deadline)
+			continue;
+		dt = jobs[i].deadline - monotime();
+		if (min < 0 || dt < min)
+			min = MAX(dt, 0);
+	}
+	return min < 0 ? -1 : (int)(min * 1000) + 1;
+}
+
+/* read from the filters that have output, stop the ones out of time and
+ * start queued ones in their place; pfd is as filled by ffpollfds() and
+ * returns whether anything happened */
+static int
+ffpump(struct pollfd *pfd, int n)
+{
+	int i, k, changed = 0;
+	double now = monotime();
+
+	for (i = 0, k = 0; i < njobs && k < n; i++) {
+		if (!jobs[i].img)
+			continue;
+		if (pfd[k++].revents) {
+			jobread(&jobs[i]);
+			changed = 1;
+		}
+	}
+	for (i = 0; i < njobs; i++) {
+		if (jobs[i].img && jobs[i].deadline && now >= jobs[i].deadline) {
+			jobfail(&jobs[i], "filter timed out");
+			changed = 1;
+		}
+	}
+	for (i = 0; i < njobs; i++) {
+		while (queue && !jobs[i].img) {
+			jobstart(&jobs[i]);
+			changed = 1;
+		}
+	}
+	return changed;
+}
+
+/* block until every queued image is decoded or has failed */
+void
+ffwait(void)
+{
+	struct pollfd *pfd = ecalloc(MAX(njobs, 1), sizeof(*pfd));
+	int n;
+
+	ffpump(pfd, 0);
+	while (queue || jobsrunning) {
+		n = ffpollfds(pfd);
+		if (poll(pfd, n, fftimeout()) < 0 && errno != EINTR)
+			die("sent: Unable to poll:");
+		ffpump(pfd, n);
+	}
+	free(pfd);
+}
+
+/* queue img for decoding unless it is decoded, on its way or broken */
+static void
+ffqueue(Image *img)
+{
+	if (img->buf || img->state & (QUEUED | DECODING | FAILED))
+		return;
+	img->state |= QUEUED;
+	*queuetail = img;
+	queuetail = &img->qnext;
+	if (!jobs) {
+		njobs = MAX(maxfilters, 1);
+		jobs = ecalloc(njobs, sizeof(*jobs));
+	}
+	ffpump(NULL, 0);
+}
+
+/* image of filename, shared with whatever shows the same file already;
+ * new images are not queued yet and failures are placeholders */
+static Image *
+ffopen(const char *filename)
+{
+	const char *bin;
+	char path[PATH_MAX];
+	uint64_t hash = 0;
+	off_t size = 0;
+	Image *img;
+	int fd, cached;
+
+	if (!(bin = findfilter(filename)))
+		return ffbroken(filename, "no matching filter");
+
+	/* the same file, or a file with the same content, is decoded once */
+	if (!realpath(filename, path))
+		return ffbroken(filename, strerror(errno));
+	for (img = images; img; img = img->next) {
+		if (!strcmp(img->path, path)) {
+			stats.imghits++;
+			return imageref(img);
+		}
+	}
+	if ((fd = open(path, O_RDONLY)) < 0)
+		return ffbroken(filename, strerror(errno));
+	cached = !filehash(fd, &hash, &size);
+	close(fd);
+	for (img = images; cached && img; img = img->next) {
+		if (img->size == size && img->hash == hash &&
+		    samecontent(img->path, path, size)) {
+			stats.imghits++;
+			return imageref(img);
+		}
+	}
+	stats.imgmisses++;
+
+	img = arenaalloc(&deck, sizeof(Image));
+	memset(img, 0, sizeof(Image));
+	img->refs = 1;
+	img->path = arenaalloc(&deck, strlen(path) + 1);
+	strcpy(img->path, path);
+	img->bin = bin;
+	img->hash = hash;
+	img->size = size;
+	img->next = images;
+	images = img;
+	return img;
+}
+
+static int
+cmpname(const void *a, const void *b)
+{
+	return strcmp(*(char *const *)a, *(char *const *)b);
+}
 
-	for (i = 0; i < LEN(filters); i++) {
-		if (regcomp(&regex, filters[i].regex,
-		            REG_NOSUB | REG_EXTENDED | REG_ICASE)) {
-			fprintf(stderr, "sent: Invalid regex '%s'\n", filters[i].regex);
+/* one frame per file of the directory dir with a filter, hidden files
+ * left out; only the first frame is queued, the others once the slide
+ * is shown */
+static void
+ffloadframes(Slide *s, const char *dir)
+{
+	DIR *dp;
+	struct dirent *de;
+	char **names = NULL, **nnames, path[PATH_MAX];
+	size_t n = 0, cap = 0, i;
+
+	if (!(dp = opendir(dir))) {
+		s->img = ffbroken(dir, strerror(errno));
+		return;
+	}
+	while ((de = readdir(dp))) {
+		if (de->d_name[0] == '.' || !findfilter(de->d_name))
 			continue;
+		if (n == cap) {
+			cap = cap ? cap * 2 : 64;
+			if (!(nnames = realloc(names, cap * sizeof(*names))))
+				die("sent: Unable to reallocate %zu bytes:",
+				    cap * sizeof(*names));
+			names = nnames;
 		}
-		if (!regexec(&regex, filename, 0, NULL, 0)) {
-			bin = filters[i].bin;
-			regfree(&regex);
+		names[n] = arenaalloc(&deck, strlen(de->d_name) + 1);
+		strcpy(names[n++], de->d_name);
+	}
+	closedir(dp);
+	if (!n) {
+		s->img = ffbroken(dir, "no frames");
+		return;
+	}
+	qsort(names, n, sizeof(*names), cmpname);
+
+	s->frames = arenaalloc(&deck, n * sizeof(*s->frames));
+	for (i = 0; i < n; i++) {
+		if (snprintf(path, sizeof(path), "%s/%s", dir, names[i]) >= sizeof(path))
+			s->frames[i] = ffbroken(names[i], "path too long");
+		else
+			s->frames[i] = ffopen(path);
+	}
+	free(names);
+	s->nframes = n;
+	s->frame = 0;
+	s->img = s->frames[0];
+	ffqueue(s->img);
+}
+
+/* attach the image of s, which is queued for decoding unless another
+ * slide shows the same file already; failures leave a placeholder */
+void
+ffload(Slide *s)
+{
+	struct stat st;
+	double t;
+
+	if (s->img || !s->embed || !s->embed[0])
+		return; /* already done */
+	if ((s->img = binimage(s)))
+		return;
+	TRACEBEGIN(t);
+
+	if (!stat(s->embed, &st) && S_ISDIR(st.st_mode))
+		ffloadframes(s, s->embed);
+	else
+		ffqueue(s->img = ffopen(s->embed));
+	TRACEEND("ffload", t, slideidx(s));
+}
+
+/* largest size of img fitting the usable area, keeping its aspect */
+static void
+fffit(Image *img, int *width, int *height)
+{
+	*width = xw.uw;
+	*height = xw.uh;
+	if (xw.uw * img->bufheight > xw.uh * img->bufwidth)
+		*width = img->bufwidth * xw.uh / img->bufheight;
+	else
+		*height = img->bufheight * xw.uw / img->bufwidth;
+	*width = MAX(*width, 1);
+	*height = MAX(*height, 1);
+}
+
+/* XImage with pooled pixel data, to be released with ximgfree() */
+static XImage *
+ffximage(int width, int height)
+{
+	int depth = DefaultDepth(xw.dpy, xw.scr);
+	XImage *ximg;
+
+	if (xw.vis->class != TrueColor && xw.vis->class != DirectColor)
+		die("sent: Only TrueColor and DirectColor displays are supported");
+
+	if (!(ximg = XCreateImage(xw.dpy, xw.vis, depth, ZPixmap, 0,
+	                          NULL, width, height, 32, 0)))
+		die("sent: Unable to create XImage");
+
+	ximg->data = poolget(height * ximg->bytes_per_line);
+	if (!XInitImage(ximg))
+		die("sent: Unable to initiate XImage");
+	return ximg;
+}
+
+/* upload img at full size with its alpha once, so that the server
+ * scales and composites it onto any background from then on */
+static void
+ffupload(Image *img)
+{
+	XRenderPictureAttributes pa = { .repeat = RepeatPad };
+	XImage *ximg;
+	unsigned char *src = img->buf;
+	uint32_t *dst;
+	size_t i, n = (size_t)img->bufwidth * img->bufheight;
+	uint16_t one = 1;
+	GC gc;
+	double t, t0;
+
+	TRACEBEGIN(t);
+	t0 = monotime();
+	if (!(ximg = XCreateImage(xw.dpy, CopyFromParent, 32, ZPixmap, 0, NULL,
+	                          img->bufwidth, img->bufheight, 32, 0)))
+		die("sent: Unable to create XImage");
+	/* whole ARGB words in host order, Xlib swaps them for the server */
+	ximg->byte_order = *(unsigned char *)&one ? LSBFirst : MSBFirst;
+	ximg->data = poolget(img->bufheight * ximg->bytes_per_line);
+	if (!XInitImage(ximg))
+		die("sent: Unable to initiate XImage");
+	for (i = 0, dst = (uint32_t *)ximg->data; i < n; i++, src += 4)
+		dst[i] = (uint32_t)src[3] << 24 | (uint32_t)src[0] << 16 |
+		         (uint32_t)src[1] << 8 | src[2];
+
+	img->pix = XCreatePixmap(xw.dpy, d->root, img->bufwidth, img->bufheight, 32);
+	gc = XCreateGC(xw.dpy, img->pix, 0, NULL);
+	XPutImage(xw.dpy, img->pix, gc, ximg, 0, 0, 0, 0,
+	          img->bufwidth, img->bufheight);
+	XFreeGC(xw.dpy, gc);
+	ximgdestroy(ximg);
+
+	/* pad rather than fade to black where the filter reaches past
+	 * the edges */
+	img->pic = XRenderCreatePicture(xw.dpy, img->pix, imgfmt, CPRepeat, &pa);
+	XRenderSetPictureFilter(xw.dpy, img->pic, FilterBest, NULL, 0);
+	img->picw = img->pich = 0;
+	stats.uploads++;
+	stats.uploadtime += monotime() - t0;
+	TRACEEND("ffupload", t, idx);
+}
+
+/* send img scaled and dithered to 16 bits per pixel on the client, half
+ * of what a 32 bit XImage takes and a fraction of a full size upload;
+ * the server converts it to the depth of the window */
+static void
+fflowbw(Image *img, int width, int height)
+{
+	XImage *ximg;
+	GC gc;
+	double t, t0;
+
+	if (img->pic && img->picw == width && img->pich == height &&
+	    img->ximgbg == sc[ColBg].pixel)
+		return;
+	fffreepic(img);
+
+	TRACEBEGIN(t);
+	t0 = monotime();
+	if (!(ximg = XCreateImage(xw.dpy, NULL, 16, ZPixmap, 0, NULL,
+	                          width, height, 16, 0)))
+		die("sent: Unable to create XImage");
+	ximg->red_mask = 0xF800;
+	ximg->green_mask = 0x07E0;
+	ximg->blue_mask = 0x001F;
+	ximg->data = poolget(height * ximg->bytes_per_line);
+	if (!XInitImage(ximg))
+		die("sent: Unable to initiate XImage");
+	ffscaleto(img, ximg);
+
+	img->pix = XCreatePixmap(xw.dpy, d->root, width, height, 16);
+	gc = XCreateGC(xw.dpy, img->pix, 0, NULL);
+	XPutImage(xw.dpy, img->pix, gc, ximg, 0, 0, 0, 0, width, height);
+	XFreeGC(xw.dpy, gc);
+	ximgdestroy(ximg);
+
+	img->pic = XRenderCreatePicture(xw.dpy, img->pix, lowfmt, 0, NULL);
+	img->picw = width;
+	img->pich = height;
+	img->picfixed = 1;
+	img->ximgbg = sc[ColBg].pixel;
+	stats.scales++;
+	stats.scaletime += monotime() - t0;
+	TRACEEND("fflowbw", t, idx);
+}
+
+void
+ffprepare(Image *img)
+{
+	int width, height;
+	double t, ts, ts0;
+
+	TRACEBEGIN(t);
+	fffit(img, &width, &height);
+
+	if (lowfmt) {
+		fflowbw(img, width, height);
+		img->state |= SCALED;
+		TRACEEND("ffprepare", t, idx);
+		return;
+	}
+	/* the server scales in sRGB, linear light is scaled here */
+	if (imgfmt && !img->linear && img->bufwidth <= MAXPICTSIZE &&
+	    img->bufheight <= MAXPICTSIZE) {
+		if (!img->pic)
+			ffupload(img);
+		img->state |= SCALED;
+		TRACEEND("ffprepare", t, idx);
+		return;
+	}
+
+	/* slides sharing the image may have scaled it already */
+	if (img->ximg && img->ximg->width == width && img->ximg->height == height &&
+	    img->ximgbg == sc[ColBg].pixel) {
+		img->state |= SCALED;
+		return;
+	}
+	ximgfree(img);
+	img->ximg = ffximage(width, height);
+
+	TRACEBEGIN(ts);
+	ts0 = monotime();
+	ffscale(img);
+	stats.scales++;
+	stats.scaletime += monotime() - ts0;
+	TRACEEND("ffscale", ts, idx);
+	img->ximgbg = sc[ColBg].pixel;
+	img->state |= SCALED;
+	TRACEEND("ffprepare", t, idx);
+}
+
+/* build the next band of rows of the next halving of img with a 2x2
+ * box filter; returns 0 once the pyramid is complete */
+int
+ffmipmap(Image *img)
+{
+	const unsigned char *src = img->buf, *a, *b;
+	const uint16_t *a16, *b16;
+	unsigned char *dst, *o;
+	uint16_t *o16;
+	unsigned int sw = img->bufwidth, w, h, x, y, end;
+	size_t bpp = bufbpp(img);
+	int n = img->nmips;
+
+	if (img->mipsdone || !ffready(img))
+		return 0;
+	if (n) {
+		src = img->mip[n - 1];
+		sw = img->mipw[n - 1];
+	}
+	if (!img->miprow) {
+		w = sw / 2;
+		h = (n ? img->miph[n - 1] : img->bufheight) / 2;
+		if (n == NUMMIPS || w < MIPMIN || h < MIPMIN) {
+			img->mipsdone = 1;
+			return 0;
+		}
+		img->mip[n] = poolget(w * h * bpp);
+		img->mipw[n] = w;
+		img->miph[n] = h;
+	}
+	w = img->mipw[n];
+	h = img->miph[n];
+	dst = img->mip[n];
+
+	end = MIN(img->miprow + MIPBAND, h);
+	for (y = img->miprow; y < end; y++) {
+		a = &src[2 * y * sw * bpp];
+		b = a + sw * bpp;
+		o = &dst[y * w * bpp];
+		if (img->linear) {
+			a16 = (const uint16_t *)a;
+			b16 = (const uint16_t *)b;
+			o16 = (uint16_t *)o;
+			for (x = 0; x < w; x++, a16 += 8, b16 += 8, o16 += 4) {
+				o16[0] = (a16[0] + a16[4] + b16[0] + b16[4] + 2) >> 2;
+				o16[1] = (a16[1] + a16[5] + b16[1] + b16[5] + 2) >> 2;
+				o16[2] = (a16[2] + a16[6] + b16[2] + b16[6] + 2) >> 2;
+				o16[3] = (a16[3] + a16[7] + b16[3] + b16[7] + 2) >> 2;
+			}
+			continue;
+		}
+		for (x = 0; x < w; x++, a += 8, b += 8, o += 4) {
+			o[0] = (a[0] + a[4] + b[0] + b[4] + 2) >> 2;
+			o[1] = (a[1] + a[5] + b[1] + b[5] + 2) >> 2;
+			o[2] = (a[2] + a[6] + b[2] + b[6] + 2) >> 2;
+			o[3] = (a[3] + a[7] + b[3] + b[7] + 2) >> 2;
+		}
+	}
+	if ((img->miprow = end) == h) {
+		img->miprow = 0;
+		img->nmips++;
+	}
+	return 1;
+}
+
+/* build a band of a mip level of some slide's image; returns 0 once
+ * there is nothing left to do */
+static int
+ffidle(void)
+{
+	double t;
+
+	for (; mipslide < slidecount; mipslide++) {
+		/* frames are shown too briefly to be worth it */
+		if (!slides[mipslide].img || slides[mipslide].nframes)
+			continue;
+		TRACEBEGIN(t);
+		if (ffmipmap(slides[mipslide].img)) {
+			TRACEEND("ffmipmap", t, mipslide);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* keep the animbuffer frames from the shown one on decoded or on their
+ * way, nearest first, and let go of the others */
+static void
+animfill(Slide *s)
+{
+	unsigned int i, k;
+
+	for (k = 0; k < s->nframes; k++) {
+		i = (s->frame + k) % s->nframes;
+		if (k < MAX(animbuffer, 2))
+			ffqueue(s->frames[i]);
+		else if (s->frames[i]->refs == 1)
+			ffevict(s->frames[i]);
+	}
+}
+
+/* follow the shown slide: an animated slide starts over from its first
+ * frame when it is shown and keeps only that one once it is left */
+static void
+animsync(void)
+{
+	Slide *s;
+	unsigned int i;
+	int cur = slidecount && !ovopen ? idx : -1;
+
+	if (cur == animslide)
+		return;
+	if (animslide >= 0 && animslide < slidecount) {
+		s = &slides[animslide];
+		for (i = 1; i < s->nframes; i++)
+			if (s->frames[i]->refs == 1)
+				ffevict(s->frames[i]);
+		if (s->nframes) {
+			s->img->state &= ~SCALED;
+			s->frame = 0;
+			s->img = s->frames[0];
+			ffqueue(s->img);
+		}
+	}
+	if ((animslide = cur) >= 0 && slides[cur].nframes > 1) {
+		animfill(&slides[cur]);
+		animnext = monotime() + 1.0 / framerate;
+	}
+}
+
+/* the frame after the shown one, if the shown slide is animated */
+static Image *
+animpeek(void)
+{
+	Slide *s;
+
+	if (animslide < 0 || animslide >= slidecount ||
+	    (s = &slides[animslide])->nframes < 2)
+		return NULL;
+	return s->frames[(s->frame + 1) % s->nframes];
+}
+
+/* milliseconds until the next frame is due, or -1 while it is decoded */
+static int
+animtimeout(void)
+{
+	Image *next = animpeek();
+	double dt;
+
+	if (!next || (!ffready(next) && !(next->state & FAILED)))
+		return -1;
+	dt = animnext - monotime();
+	return dt > 0 ? (int)(dt * 1000) + 1 : 0;
+}
+
+/* show the next frame once it is due and decoded; a frame that is late
+ * is shown late instead of being skipped */
+static void
+animtick(void)
+{
+	Slide *s;
+	double now;
+
+	if (animtimeout() != 0)
+		return;
+	s = &slides[animslide];
+	now = monotime();
+	s->img->state &= ~SCALED;
+	s->frame = (s->frame + 1) % s->nframes;
+	s->img = s->frames[s->frame];
+	/* prepared ahead, but maybe for another window size */
+	s->img->state &= ~SCALED;
+	if ((animnext += 1.0 / framerate) <= now)
+		animnext = now + 1.0 / framerate;
+	animfill(s);
+	xdraw();
+}
+
+/* scale or upload the next frame ahead of time; returns 0 once there is
+ * nothing left to do */
+static int
+animidle(void)
+{
+	Image *next = animpeek();
+
+	if (!next || !ffready(next) || next->state & SCALED)
+		return 0;
+	ffprepare(next);
+	return 1;
+}
+
+void
+ffscale(Image *img)
+{
+	ffscaleto(img, img->ximg);
+}
+
+/* shift and width in bits of a color channel mask */
+static void
+maskbits(unsigned long mask, int *shift, int *bits)
+{
+	for (*shift = 0; mask && !(mask & 1); mask >>= 1)
+		(*shift)++;
+	for (*bits = 0; mask & 1; mask >>= 1)
+		(*bits)++;
+}
+
+/* reduce the 8 bit channel c to bits, offset by the ordered dither
+ * threshold t in [0, 16) so that the rounding error is spread out */
+static unsigned long
+dither(unsigned int c, int bits, unsigned int t)
+{
+	if (bits >= 8)
+		return (unsigned long)c << (bits - 8);
+	c += (t << (8 - bits)) >> 4;
+	return MIN(c, 255) >> (8 - bits);
+}
+
+/* scale img into ximg, whatever size and visual it has */
+void
+ffscaleto(Image *img, XImage *ximg)
+{
+	static const unsigned char bayer[4][4] = {
+		{  0,  8,  2, 10 },
+		{ 12,  4, 14,  6 },
+		{  3, 11,  1,  9 },
+		{ 15,  7, 13,  5 },
+	};
+	unsigned int x, y;
+	unsigned int width = ximg->width;
+	unsigned int height = ximg->height;
+	unsigned char *ibuf, *o;
+	unsigned char *src = img->buf;
+	unsigned int sw = img->bufwidth, sh = img->bufheight;
+	unsigned int dx, bufx, k, r, g, b, t;
+	unsigned int bg_r = sc[ColBg].color.red >> 8;
+	unsigned int bg_g = sc[ColBg].color.green >> 8;
+	unsigned int bg_b = sc[ColBg].color.blue >> 8;
+	unsigned long px;
+	const unsigned char *p;
+	const uint16_t *q;
+	size_t bpp = bufbpp(img);
+	int i, rs, rb, gs, gb, bs, bb, fast, native;
+	uint16_t one = 1;
+
+	/* start from the smallest halving that still covers the target */
+	for (i = 0; i < img->nmips && img->mipw[i] >= width && img->miph[i] >= height; i++) {
+		src = img->mip[i];
+		sw = img->mipw[i];
+		sh = img->miph[i];
+	}
+	dx = (sw << 10) / width;
+	if (img->linear) {
+		bg_r = tolinear[sc[ColBg].color.red];
+		bg_g = tolinear[sc[ColBg].color.green];
+		bg_b = tolinear[sc[ColBg].color.blue];
+	}
+
+	/* 888 in 32 bits is written bytewise, anything else is dithered
+	 * down to the channel widths of the visual */
+	fast = ximg->bits_per_pixel == 32 && ximg->byte_order == LSBFirst &&
+	       ximg->red_mask == 0xFF0000 && ximg->green_mask == 0xFF00 &&
+	       ximg->blue_mask == 0xFF;
+	native = ximg->byte_order == (*(unsigned char *)&one ? LSBFirst : MSBFirst);
+	maskbits(ximg->red_mask, &rs, &rb);
+	maskbits(ximg->green_mask, &gs, &gb);
+	maskbits(ximg->blue_mask, &bs, &bb);
+
+	for (y = 0; y < height; y++) {
+		bufx = sw / width;
+		ibuf = &src[(size_t)(y * sh / height) * sw * bpp];
+		o = (unsigned char *)ximg->data + y * ximg->bytes_per_line;
+
+		/* composite onto the current background */
+		for (x = 0; x < width; x++, bufx += dx) {
+			if (img->linear) {
+				/* blend in linear light, then encode once */
+				q = (const uint16_t *)ibuf + (bufx >> 10) * 4;
+				k = 65535 - q[3];
+				r = tosrgb[(q[0] + (bg_r * k + 32767) / 65535) >> 4];
+				g = tosrgb[(q[1] + (bg_g * k + 32767) / 65535) >> 4];
+				b = tosrgb[(q[2] + (bg_b * k + 32767) / 65535) >> 4];
+			} else {
+				p = &ibuf[(bufx >> 10) * 4];
+				k = 255 - p[3];
+				r = p[0] + (bg_r * k + 127) / 255;
+				g = p[1] + (bg_g * k + 127) / 255;
+				b = p[2] + (bg_b * k + 127) / 255;
+			}
+			if (fast) {
+				o[x * 4 + 0] = b;
+				o[x * 4 + 1] = g;
+				o[x * 4 + 2] = r;
+				o[x * 4 + 3] = 0;
+				continue;
+			}
+			t = bayer[y & 3][x & 3];
+			px = dither(r, rb, t) << rs | dither(g, gb, t) << gs |
+			     dither(b, bb, t) << bs;
+			if (native && ximg->bits_per_pixel == 16)
+				((uint16_t *)o)[x] = px;
+			else if (native && ximg->bits_per_pixel == 32)
+				((uint32_t *)o)[x] = px;
+			else
+				XPutPixel(ximg, x, y, px);
+		}
+	}
+}
+
+void
+ffdraw(Image *img)
+{
+	XTransform xf = { { { 0 } } };
+	Picture dst;
+	int xoffset, yoffset, width, height;
+	double t;
+
+	TRACEBEGIN(t);
+	if (img->pic) {
+		/* a new size only needs a new transform */
+		fffit(img, &width, &height);
+		if (img->picfixed) {
+			width = img->picw;
+			height = img->pich;
+		} else if (width != img->picw || height != img->pich) {
+			xf.matrix[0][0] = XDoubleToFixed((double)img->bufwidth / width);
+			xf.matrix[1][1] = XDoubleToFixed((double)img->bufheight / height);
+			xf.matrix[2][2] = XDoubleToFixed(1);
+			XRenderSetPictureTransform(xw.dpy, img->pic, &xf);
+			img->picw = width;
+			img->pich = height;
+		}
+		dst = XRenderCreatePicture(xw.dpy, d->drawable, winfmt, 0, NULL);
+		XRenderComposite(xw.dpy, img->picfixed ? PictOpSrc : PictOpOver,
+		                 img->pic, None, dst, 0, 0, 0, 0,
+		                 (xw.w - width) / 2, (xw.h - height) / 2,
+		                 width, height);
+		XRenderFreePicture(xw.dpy, dst);
+		TRACEEND("XRenderComposite", t, idx);
+		return;
+	}
+
+	xoffset = (xw.w - img->ximg->width) / 2;
+	yoffset = (xw.h - img->ximg->height) / 2;
+	XPutImage(xw.dpy, d->drawable, d->gc, img->ximg, 0, 0,
+	          xoffset, yoffset, img->ximg->width, img->ximg->height);
+	TRACEEND("XPutImage", t, idx);
+}
+
+/* the channel of px at shift, bits wide, widened to 16 bits by
+ * repeating its bits, so that full intensity stays 0xFFFF */
+static uint16_t
+chanwiden(unsigned long px, int shift, int bits)
+{
+	uint32_t c, v = 0;
+	int n;
+
+	if (!bits)
+		return 0;
+	c = (px >> shift) & ((1UL << bits) - 1);
+	for (n = 0; n < 16; n += bits)
+		v = v << bits | c;
+	return v >> (n - 16);
+}
+
+/* convert row y of ximg to farbfeld, whatever its visual and byte order */
+static void
+ffrow(XImage *ximg, unsigned int y, uint16_t *row)
+{
+	uint32_t *src = (uint32_t *)(ximg->data + y * ximg->bytes_per_line);
+	unsigned long px;
+	unsigned int x;
+	int rs, rb, gs, gb, bs, bb, native;
+	uint16_t one = 1;
+
+	native = ximg->bits_per_pixel == 32 &&
+	         ximg->byte_order == (*(unsigned char *)&one ? LSBFirst : MSBFirst);
+	maskbits(ximg->red_mask, &rs, &rb);
+	maskbits(ximg->green_mask, &gs, &gb);
+	maskbits(ximg->blue_mask, &bs, &bb);
+	for (x = 0; x < ximg->width; x++) {
+		px = native ? src[x] : XGetPixel(ximg, x, y);
+		row[x * 4 + 0] = htons(chanwiden(px, rs, rb));
+		row[x * 4 + 1] = htons(chanwiden(px, gs, gb));
+		row[x * 4 + 2] = htons(chanwiden(px, bs, bb));
+		row[x * 4 + 3] = 0xFFFF;
+	}
+}
+
+/* write the current contents of the drawing buffer as farbfeld */
+void
+ffwrite(FILE *fp)
+{
+	XImage *ximg;
+	uint32_t hdr[2];
+	uint16_t *row;
+	unsigned int y;
+
+	if (!(ximg = XGetImage(xw.dpy, d->drawable, 0, 0, xw.w, xw.h,
+	                       AllPlanes, ZPixmap)))
+		die("sent: Unable to read back drawing buffer");
+
+	hdr[0] = htonl(xw.w);
+	hdr[1] = htonl(xw.h);
+	fputs("farbfeld", fp);
+	fwrite(hdr, sizeof(hdr), 1, fp);
+
+	row = ecalloc(xw.w, 2 * strlen("RGBA"));
+	for (y = 0; y < xw.h; y++) {
+		ffrow(ximg, y, row);
+		if (fwrite(row, 2 * strlen("RGBA"), xw.w, fp) != xw.w)
+			die("sent: Unable to write image data:");
+	}
+	free(row);
+	XDestroyImage(ximg);
+}
+
+/* hash of everything font fitting depends on besides the window size */
+static uint32_t
+fontkey(void)
+{
+	uint32_t h = 2166136261u;
+	unsigned int i;
+	const char *c;
+	float ls = linespacing;
+
+	for (i = 0; i < LEN(fontfallbacks); i++)
+		for (c = fontfallbacks[i]; ; c++) {
+			h = (h ^ (unsigned char)*c) * 16777619u;
+			if (!*c)
+				break;
+		}
+	h = (h ^ MINFONTSIZE) * 16777619u;
+	h = (h ^ MAXFONTSIZE) * 16777619u;
+	h = (h ^ (uint32_t)(FONTSTEP * 1000)) * 16777619u;
+	for (i = 0; i < sizeof(ls); i++)
+		h = (h ^ ((unsigned char *)&ls)[i]) * 16777619u;
+	return h;
+}
+
+/* font fit for s at the current window size from the compiled deck */
+static const BinFitSlide *
+binfit(Slide *s)
+{
+	const BinFit *fit;
+	uint32_t i;
+	int n;
+
+	if (!binhdr || !binhdr->fitcount || (n = slideidx(s)) < 0 ||
+	    binhdr->fontkey != fontkey())
+		return NULL;
+	fit = (const BinFit *)(deckbin + binhdr->fitoff);
+	for (i = 0; i < binhdr->fitcount; i++)
+		if (fit[i].uw == xw.uw && fit[i].uh == xw.uh)
+			return (const BinFitSlide *)(deckbin + fit[i].off) + n;
+	return NULL;
+}
+
+/* the fontset of size pixels, opened if it is not yet, in the slots of
+ * thumbnails if thumb is set */
+static Fnt *
+fontat(int size, int thumb)
+{
+	char fstrs[LEN(fontfallbacks)][MAXFONTSTRLEN];
+	const char *names[LEN(fontfallbacks)];
+	int i, lru = thumb ? NUMFONTS : 0;
+	Fnt *f;
+
+	LIMIT(size, MINFONTSIZE, MAXFONTSIZE);
+	for (i = lru; i < (thumb ? LEN(fonts) : NUMFONTS); i++) {
+		if (fonts[i].size == size) {
+			stats.fonthits++;
+			fonts[i].used = ++fontclock;
+			return fonts[i].set;
+		}
+		if (fonts[i].used < fonts[lru].used)
+			lru = i;
+	}
+	stats.fontmisses++;
+
+	for (i = 0; i < LEN(fontfallbacks); i++) {
+		if (MAXFONTSTRLEN <= snprintf(fstrs[i], MAXFONTSTRLEN, "%s:pixelsize=%d", fontfallbacks[i], size))
+			die("sent: Font string too long");
+		names[i] = fstrs[i];
+	}
+	drw_fontset_free(fonts[lru].set);
+	if (!(f = drw_fontset_create(d, names, LEN(names))))
+		die("sent: Unable to load any font for size %d", size);
+	fonts[lru].size = size;
+	fonts[lru].set = f;
+	fonts[lru].used = ++fontclock;
+	for (fonts[lru].base = 0; f; f = f->next)
+		fonts[lru].base++;
+	return fonts[lru].set;
+}
+
+/* size rounded down to the sizes from MINFONTSIZE up by FONTSTEP, or
+ * THUMBFONTSTEP for thumbnails, so that slides with about as much text
+ * share their fonts.  The sizes are whole pixels and at least one apart,
+ * so small sizes map to themselves. */
+static int
+fontround(int size)
+{
+	float fontstep = fontthumb ? THUMBFONTSTEP : FONTSTEP;
+	int r, next;
+
+	LIMIT(size, MINFONTSIZE, MAXFONTSIZE);
+	for (r = MINFONTSIZE; ; r = next) {
+		next = MAX(r + 1, (int)(r * fontstep + 0.5));
+		if (next > size)
+			return r;
+	}
+}
+
+/* the widest line of s in the current fontset */
+static unsigned int
+slidewidth(Slide *s)
+{
+	unsigned int i, w = 0;
+
+	for (i = 0; i < s->linecount; i++)
+		w = MAX(w, drw_fontset_getwidth(d, s->lines[i]));
+	return w;
+}
+
+void
+getfontsize(Slide *s, unsigned int *width, unsigned int *height)
+{
+	float lfac = linespacing * (s->linecount - 1) + 1;
+	const BinFitSlide *fit;
+	unsigned int w;
+	int size;
+
+	/* the compiled deck may already know the answer */
+	if ((fit = binfit(s)) && fit->font >= MINFONTSIZE &&
+	    fit->font <= MAXFONTSIZE) {
+		stats.fithits++;
+		drw_setfontset(d, fontat(fit->font, fontthumb));
+		*width = fit->width;
+		*height = d->fonts->h * lfac;
+		return;
+	}
+
+	stats.fitmisses++;
+
+	/* text scales with the font size, so one measurement of each slide
+	 * gives the size that fits any window */
+	if (!s->refw) {
+		drw_setfontset(d, fontat(REFFONTSIZE, 0));
+		s->refw = MAX(slidewidth(s), 1);
+	}
+	size = REFFONTSIZE * MIN((float)xw.uw / s->refw, xw.uh / (refh * lfac));
+
+	/* hinting does not scale exactly, shrink until it fits */
+	for (;;) {
+		size = fontround(size);
+		drw_setfontset(d, fontat(size, fontthumb));
+		w = slidewidth(s);
+		if (size == MINFONTSIZE ||
+		    (w <= xw.uw && d->fonts->h * lfac <= xw.uh))
+			break;
+		size = MIN(size - 1, size * MIN((float)xw.uw / w,
+		                                xw.uh / (d->fonts->h * lfac)));
+	}
+	*width = w;
+	*height = d->fonts->h * lfac;
+}
+
+void
+cleanup(int slidesonly)
+{
+	if (slidesonly)
+		ovfree();
+	else
+		free(thumbs);
+
+	/* images may hold server resources, so they go first */
+	if (slides) {
+		for (unsigned int i = 0; i < slidecount; i++)
+			fffreeslide(&slides[i]);
+		animslide = -1;
+		if (!slidesonly) {
+			free(slides);
+			slides = NULL;
+			slidecap = 0;
+		}
+	}
+
+	if (!slidesonly) {
+		ctlclose();
+		transend();
+		for (unsigned int i = 0; i < LEN(fonts); i++)
+			drw_fontset_free(fonts[i].set);
+		memset(fonts, 0, sizeof(fonts));
+		free(sc);
+		free(altsc);
+		drw_free(d);
+
+		if (xw.win)
+			XDestroyWindow(xw.dpy, xw.win);
+		XSync(xw.dpy, False);
+		XCloseDisplay(xw.dpy);
+	}
+
+	if (deckbin) {
+		munmap(deckbin, deckbinlen);
+		deckbin = NULL;
+		binhdr = NULL;
+		binimgs = NULL;
+	}
+	images = NULL;
+	queue = NULL;
+	queuetail = &queue;
+	if (!slidesonly) {
+		free(jobs);
+		jobs = NULL;
+		njobs = 0;
+	}
+	mipslide = 0;
+	indexed = matchedto = nmatches = 0;
+	if (!slidesonly) {
+		free(matches);
+		free(matchoffs);
+		matches = NULL;
+		matchoffs = NULL;
+		matchcap = 0;
+	}
+	if (!slidesonly && filtersready) {
+		for (unsigned int i = 0; i < LEN(filters); i++)
+			if (filterok[i])
+				regfree(&filterres[i]);
+		filtersready = 0;
+	}
+
+	/* drop the whole generation, keeping its memory for the next one */
+	if (slidesonly) {
+		arenareset(&deck);
+	} else {
+		arenafree(&deck);
+		poolfree();
+	}
+}
+
+void
+reload(const Arg *arg)
+{
+	FILE *fp = NULL;
+	unsigned int i;
+
+	if (!fname) {
+		fprintf(stderr, "sent: Cannot reload from stdin. Use a file!\n");
+		return;
+	}
+
+	cleanup(1);
+	slidecount = 0;
+
+	if (!(fp = fopen(fname, "r")))
+		die("sent: Unable to open '%s' for reading:", fname);
+	load(fp);
+	fclose(fp);
+
+	LIMIT(idx, 0, slidecount-1);
+	for (i = 0; i < slidecount; i++)
+		ffload(&slides[i]);
+	xdraw();
+}
+
+/* map fp if it is a regular file, otherwise read it to EOF */
+static char *
+readall(FILE *fp, size_t *len, int *mapped)
+{
+	struct stat st;
+	char *buf = NULL, *nbuf;
+	size_t cap = 0;
+	ssize_t count;
+	int fd = fileno(fp);
+
+	*len = 0;
+	*mapped = 0;
+	if (!fstat(fd, &st) && S_ISREG(st.st_mode) && st.st_size > 0) {
+		buf = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (buf != MAP_FAILED) {
+			posix_madvise(buf, st.st_size, POSIX_MADV_SEQUENTIAL);
+			*len = st.st_size;
+			*mapped = 1;
+			return buf;
+		}
+		buf = NULL;
+	}
+
+	while (1) {
+		if (*len == cap) {
+			cap = cap ? 2 * cap : BUFSIZ;
+			if (!(nbuf = realloc(buf, cap)))
+				die("sent: Unable to reallocate %zu bytes:", cap);
+			buf = nbuf;
+		}
+		if ((count = read(fd, buf + *len, cap - *len)) < 0)
+			die("sent: Unable to read input:");
+		if (!count)
+			break;
+		*len += count;
+	}
+	return buf;
+}
+
+/* append the slide made of the lines in [p, end), which holds nlines
+ * content lines taking up size bytes including their newlines */
+static void
+addslide(const char *p, const char *end, size_t nlines, size_t size)
+{
+	const char *eol;
+	char *q;
+	size_t n;
+	Slide *s;
+
+	if (slidecount == slidecap) {
+		Slide *newslides;
+
+		slidecap = slidecap ? 2 * slidecap : 64;
+		if (!(newslides = realloc(slides, slidecap * sizeof(*slides))))
+			die("sent: Unable to reallocate %zu bytes:",
+			    slidecap * sizeof(*slides));
+		slides = newslides;
+	}
+	s = &slides[slidecount];
+	memset(s, 0, sizeof(*s));
+	s->lines = arenaalloc(&deck, nlines * sizeof(*s->lines));
+	q = arenaalloc(&deck, size);
+
+	for (; p < end; p = eol + 1) {
+		if (!(eol = memchr(p, '\n', end - p)))
+			eol = end;
+		n = eol - p;
+
+		/* comments and lines with a leading null are dropped */
+		if (p[0] == '#' || p[0] == '\0')
+			continue;
+
+		/* mark as image slide if first line of a slide starts with @ */
+		if (s->linecount == 0 && p[0] == '@')
+			s->embed = q + 1;
+
+		if (p[0] == '\\') {
+			p++;
+			n--;
+		}
+		memcpy(q, p, n);
+		q[n] = '\0';
+		s->lines[s->linecount++] = q;
+		q += n + 1;
+	}
+	slidecount++;
+}
+
+/* add every complete slide in buf, i.e. every one followed by an empty
+ * line or, if eof is set, by the end of input; returns the number of
+ * bytes consumed */
+static size_t
+parse(const char *buf, size_t len, int eof)
+{
+	const char *p = buf, *q, *eol, *end = buf + len;
+	size_t nlines, size;
+
+	while (p < end) {
+		if (!(eol = memchr(p, '\n', end - p))) {
+			if (!eof)
+				break;
+			eol = end;
+		}
+		/* eat empty lines and comments between slides */
+		if (eol == p || p[0] == '#' || p[0] == '\0') {
+			p = eol + 1;
+			continue;
+		}
+
+		/* find the empty line ending the slide, counting its lines */
+		for (nlines = 0, size = 0, q = p; q < end; q = eol + 1) {
+			if (!(eol = memchr(q, '\n', end - q))) {
+				if (!eof)
+					return p - buf;
+				eol = end;
+			}
+			if (eol == q)
+				break;
+			if (q[0] != '#' && q[0] != '\0') {
+				nlines++;
+				size += eol - q + 1;
+			}
+		}
+		if (q >= end && !eof)
+			return p - buf;
+
+		addslide(p, MIN(q, end), nlines, size);
+		p = q;
+	}
+	return MIN(p, end) - buf;
+}
+
+/* length of the byte order mark of "UTF-8 (with BOM)" input */
+static size_t
+bomlen(const char *buf, size_t len)
+{
+	return (len >= 3 && !memcmp(buf, "\xEF\xBB\xBF", 3)) ? 3 : 0;
+}
+
+void
+load(FILE *fp)
+{
+	char *data;
+	size_t len, off;
+	int mapped;
+	double t;
+
+	TRACEBEGIN(t);
+	data = readall(fp, &len, &mapped);
+	if (mapped && len >= sizeof(BinHeader) && !memcmp(data, BINMAGIC, 8)) {
+		loadbin(data, len);
+		TRACEEND("load", t, -1);
+		return;
+	}
+	off = bomlen(data, len);
+	parse(data + off, len - off, 1);
+
+	if (mapped)
+		munmap(data, len);
+	else
+		free(data);
+
+	if (!slidecount)
+		die("sent: No slides in file");
+	TRACEEND("load", t, -1);
+}
+
+/* read what is available on the input stream and add the slides it
+ * completes; only the incomplete last paragraph is kept and rescanned */
+void
+readstream(void)
+{
+	static char *buf = NULL;
+	static size_t len = 0, cap = 0;
+	static int started = 0;
+	char *nbuf;
+	size_t off = 0;
+	ssize_t count;
+	int i, oldcount = slidecount, eof;
+	double t;
+
+	if (len == cap) {
+		cap = cap ? 2 * cap : BUFSIZ;
+		if (!(nbuf = realloc(buf, cap)))
+			die("sent: Unable to reallocate %zu bytes:", cap);
+		buf = nbuf;
+	}
+	if ((count = read(streamfd, buf + len, cap - len)) < 0) {
+		if (errno == EINTR || errno == EAGAIN)
+			return;
+		die("sent: Unable to read input:");
+	}
+	len += count;
+	eof = !count;
+
+	TRACEBEGIN(t);
+	if (!started) {
+		if (len < 3 && !eof)
+			return;
+		off = bomlen(buf, len);
+		started = 1;
+	}
+	off += parse(buf + off, len - off, eof);
+	memmove(buf, buf + off, len - off);
+	len -= off;
+	TRACEEND("load", t, -1);
+
+	for (i = oldcount; i < slidecount; i++)
+		ffload(&slides[i]);
+
+	if (eof) {
+		streamfd = -1;
+		free(buf);
+		buf = NULL;
+		len = cap = 0;
+		if (!slidecount)
+			die("sent: No slides in file");
+	}
+	/* the first slide replaces the empty window */
+	if (!oldcount && slidecount)
+		xdraw();
+}
+
+/* whether n elements of size bytes at off lie within a file of len bytes */
+static int
+binrange(size_t len, uint64_t off, uint64_t n, size_t size)
+{
+	return off % 8 == 0 && off <= len && n <= (len - off) / size;
+}
+
+/* take over a mapped compiled deck; the text stays in the mapping and
+ * images are attached by ffload() */
+void
+loadbin(char *data, size_t len)
+{
+	const BinHeader *h = (const BinHeader *)data;
+	const BinSlide *bs;
+	const BinImage *bi;
+	const BinFit *bf;
+	const uint64_t *lo;
+	uint32_t i, j;
+	Slide *s;
+
+	if (h->version != BINVERSION || h->endian != BINENDIAN)
+		die("sent: Compiled deck has an incompatible format, recompile it");
+
+	/* text is stored last, so a terminator at the end bounds every line */
+	if (!binrange(len, h->slideoff, h->slidecount, sizeof(*bs)) ||
+	    !binrange(len, h->lineoff, h->linecount, sizeof(*lo)) ||
+	    !binrange(len, h->imageoff, h->imagecount, sizeof(*bi)) ||
+	    !binrange(len, h->fitoff, h->fitcount, sizeof(*bf)) ||
+	    data[len - 1] != '\0')
+		die("sent: Corrupt compiled deck");
+	bs = (const BinSlide *)(data + h->slideoff);
+	lo = (const uint64_t *)(data + h->lineoff);
+	bi = (const BinImage *)(data + h->imageoff);
+	bf = (const BinFit *)(data + h->fitoff);
+	for (i = 0; i < h->imagecount; i++)
+		if (bi[i].off > len || (uint64_t)bi[i].width * bi[i].height * 4 > len - bi[i].off)
+			die("sent: Corrupt compiled deck");
+	for (i = 0; i < h->fitcount; i++)
+		if (!binrange(len, bf[i].off, h->slidecount, sizeof(BinFitSlide)))
+			die("sent: Corrupt compiled deck");
+
+	if (h->slidecount > slidecap) {
+		Slide *newslides;
+
+		if (!(newslides = realloc(slides, h->slidecount * sizeof(*slides))))
+			die("sent: Unable to reallocate %zu bytes:",
+			    h->slidecount * sizeof(*slides));
+		slides = newslides;
+		slidecap = h->slidecount;
+	}
+	for (i = 0; i < h->slidecount; i++) {
+		if (bs[i].firstline > h->linecount ||
+		    bs[i].linecount > h->linecount - bs[i].firstline ||
+		    (bs[i].embed && !bs[i].linecount) ||
+		    bs[i].image >= (int32_t)h->imagecount)
+			die("sent: Corrupt compiled deck");
+		s = &slides[i];
+		memset(s, 0, sizeof(*s));
+		s->linecount = bs[i].linecount;
+		s->lines = arenaalloc(&deck, s->linecount * sizeof(*s->lines));
+		for (j = 0; j < s->linecount; j++) {
+			if (lo[bs[i].firstline + j] >= len)
+				die("sent: Corrupt compiled deck");
+			s->lines[j] = data + lo[bs[i].firstline + j];
+		}
+		if (bs[i].embed)
+			s->embed = s->lines[0] + 1;
+	}
+	binimgs = arenaalloc(&deck, h->imagecount * sizeof(*binimgs));
+	memset(binimgs, 0, h->imagecount * sizeof(*binimgs));
+	slidecount = h->slidecount;
+	deckbin = data;
+	deckbinlen = len;
+	binhdr = h;
+
+	if (!slidecount)
+		die("sent: No slides in file");
+}
+
+/* decoded image of s from the compiled deck, if it was blended against
+ * the current background */
+static Image *
+binimage(Slide *s)
+{
+	const BinSlide *bs;
+	const BinImage *bi;
+	Image *img;
+	int n;
+
+	if (!binhdr || (n = slideidx(s)) < 0)
+		return NULL;
+	bs = (const BinSlide *)(deckbin + binhdr->slideoff) + n;
+	if (bs->image < 0)
+		return NULL;
+	if ((img = binimgs[bs->image]) && img->refs)
+		return imageref(img);
+	bi = (const BinImage *)(deckbin + binhdr->imageoff) + bs->image;
+
+	img = arenaalloc(&deck, sizeof(Image));
+	memset(img, 0, sizeof(Image));
+	img->buf = (unsigned char *)deckbin + bi->off;
+	img->bufwidth = bi->width;
+	img->bufheight = bi->height;
+	img->state = MAPPED;
+	img->refs = 1;
+	binimgs[bs->image] = img;
+	return img;
+}
+
+static void
+binwrite(FILE *fp, const void *p, size_t size)
+{
+	if (size && fwrite(p, size, 1, fp) != 1)
+		die("sent: Unable to write compiled deck:");
+}
+
+/* write the parsed deck, its decoded images and the font fits for the
+ * configured window sizes to path */
+void
+compile(const char *path)
+{
+	BinHeader h = { 0 };
+	BinSlide *bs;
+	BinImage *bi;
+	BinFit *bf;
+	BinFitSlide *fit;
+	Image **imgs;
+	FILE *fp;
+	uint64_t off, textoff;
+	unsigned int width, height;
+	uint32_t i, j, k;
+
+	if (!(xw.dpy = XOpenDisplay(NULL)))
+		die("sent: Unable to open display");
+	xw.scr = XDefaultScreen(xw.dpy);
+	xw.vis = XDefaultVisual(xw.dpy, xw.scr);
+	xinitdrw(XRootWindow(xw.dpy, xw.scr));
+	for (k = 0; k < LEN(compilesizes); k++) {
+		decodew = MAX(decodew, compilesizes[k][0]);
+		decodeh = MAX(decodeh, compilesizes[k][1]);
+	}
+
+	bs = ecalloc(slidecount, sizeof(*bs));
+	imgs = ecalloc(slidecount, sizeof(*imgs));
+	for (i = 0; i < slidecount; i++) {
+		bs[i].firstline = h.linecount;
+		bs[i].linecount = slides[i].linecount;
+		bs[i].embed = slides[i].embed != NULL;
+		bs[i].image = -1;
+		h.linecount += slides[i].linecount;
+		ffload(&slides[i]);
+	}
+	ffwait();
+	for (i = 0; i < slidecount; i++) {
+		if (!slides[i].img || !ffready(slides[i].img))
+			continue;
+		/* slides share decoded images, store each of them once */
+		for (j = 0; j < h.imagecount && imgs[j] != slides[i].img; j++)
+			;
+		if (j == h.imagecount)
+			imgs[h.imagecount++] = slides[i].img;
+		bs[i].image = j;
+	}
+
+	fit = ecalloc((size_t)LEN(compilesizes) * slidecount, sizeof(*fit));
+	for (k = 0; k < LEN(compilesizes); k++) {
+		resize(compilesizes[k][0], compilesizes[k][1]);
+		for (i = 0; i < slidecount; i++) {
+			getfontsize(&slides[i], &width, &height);
+			for (j = 0; j < NUMFONTS && fonts[j].set != d->fonts; j++)
+				;
+			fit[k * slidecount + i].font = fonts[j].size;
+			fit[k * slidecount + i].width = width;
+		}
+	}
+
+	memcpy(h.magic, BINMAGIC, sizeof(h.magic));
+	h.version = BINVERSION;
+	h.endian = BINENDIAN;
+	h.slidecount = slidecount;
+	h.fitcount = LEN(compilesizes);
+	h.fontkey = fontkey();
+	h.slideoff = sizeof(h);
+	h.lineoff = h.slideoff + (uint64_t)slidecount * sizeof(*bs);
+	h.imageoff = h.lineoff + (uint64_t)h.linecount * sizeof(uint64_t);
+	h.fitoff = h.imageoff + (uint64_t)h.imagecount * sizeof(*bi);
+	off = h.fitoff + (uint64_t)h.fitcount * sizeof(*bf);
+
+	bf = ecalloc(h.fitcount, sizeof(*bf));
+	for (k = 0; k < h.fitcount; k++) {
+		bf[k].uw = usablewidth * compilesizes[k][0];
+		bf[k].uh = usableheight * compilesizes[k][1];
+		bf[k].off = off;
+		off += (uint64_t)slidecount * sizeof(*fit);
+	}
+	bi = ecalloc(h.imagecount, sizeof(*bi));
+	for (k = 0; k < h.imagecount; k++) {
+		bi[k].width = imgs[k]->bufwidth;
+		bi[k].height = imgs[k]->bufheight;
+		bi[k].off = off;
+		off += (uint64_t)bi[k].width * bi[k].height * 4;
+	}
+	textoff = off;
+
+	if (!(fp = fopen(path, "w")))
+		die("sent: Unable to open '%s' for writing:", path);
+	binwrite(fp, &h, sizeof(h));
+	binwrite(fp, bs, slidecount * sizeof(*bs));
+	for (i = 0, off = textoff; i < slidecount; i++) {
+		for (j = 0; j < slides[i].linecount; j++) {
+			binwrite(fp, &off, sizeof(off));
+			off += strlen(slides[i].lines[j]) + 1;
+		}
+	}
+	binwrite(fp, bi, h.imagecount * sizeof(*bi));
+	binwrite(fp, bf, h.fitcount * sizeof(*bf));
+	binwrite(fp, fit, (size_t)h.fitcount * slidecount * sizeof(*fit));
+	for (k = 0; k < h.imagecount; k++)
+		binwrite(fp, imgs[k]->buf, (size_t)bi[k].width * bi[k].height * 4);
+	for (i = 0; i < slidecount; i++)
+		for (j = 0; j < slides[i].linecount; j++)
+			binwrite(fp, slides[i].lines[j], strlen(slides[i].lines[j]) + 1);
+	if (fclose(fp))
+		die("sent: Unable to write '%s':", path);
+
+	free(bs);
+	free(bi);
+	free(bf);
+	free(fit);
+	free(imgs);
+	cleanup(0);
+}
+
+void
+advance(const Arg *arg)
+{
+	int new_idx = idx + arg->i;
+	LIMIT(new_idx, 0, slidecount-1);
+	if (slidecount && new_idx != idx) {
+		if (slides[idx].img)
+			slides[idx].img->state &= ~SCALED;
+		transbegin(transition, new_idx);
+		idx = new_idx;
+		xdraw();
+	}
+}
+
+static int
+fold(int c)
+{
+	return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+}
+
+/* fold ASCII letters in place; branch free so it vectorizes */
+static void
+foldstr(char *p, size_t n)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++)
+		p[i] += ((unsigned char)(p[i] - 'A') < 26) * ('a' - 'A');
+}
+
+static uint64_t
+foldmask(const char *p, size_t n)
+{
+	unsigned char seen[64] = { 0 };
+	uint64_t mask = 0;
+	size_t i;
+
+	/* independent stores instead of one long chain of ors */
+	for (i = 0; i < n; i++)
+		seen[(unsigned char)p[i] & 63] = 1;
+	for (i = 0; i < 64; i++)
+		mask |= (uint64_t)seen[i] << i;
+	return mask;
+}
+
+/* add up to max slides parsed since the last call to the search index;
+ * returns 0 once every slide is indexed */
+int
+indexslides(int max)
+{
+	Slide *s;
+	size_t n;
+	char *q;
+	unsigned int i;
+
+	for (; indexed < slidecount && max > 0; indexed++, max--) {
+		s = &slides[indexed];
+		for (n = 0, i = 0; i < s->linecount; i++)
+			n += strlen(s->lines[i]) + 1;
+		q = s->text = arenaalloc(&deck, n + 1);
+		for (i = 0; i < s->linecount; i++) {
+			n = strlen(s->lines[i]);
+			memcpy(q, s->lines[i], n);
+			q += n;
+			*q++ = '\n';
+		}
+		*q = '\0';
+		s->textlen = q - s->text;
+		foldstr(s->text, s->textlen);
+		s->mask = foldmask(s->text, s->textlen);
+	}
+	return indexed < slidecount;
+}
+
+/* whether the folded query occurs in s at or after *off, which is set
+ * to the first match; no query spans two lines as it cannot contain a
+ * newline */
+static int
+slidematches(Slide *s, uint64_t mask, size_t *off)
+{
+	const char *p = s->text + *off, *end = s->text + s->textlen;
+
+	if ((s->mask & mask) != mask || s->textlen - *off < querylen)
+		return 0;
+	for (; (p = memchr(p, query[0], end - p - querylen + 1)); p++) {
+		if (!memcmp(p, query, querylen)) {
+			*off = p - s->text;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* recompute the matches of query, only rechecking the previous ones if
+ * narrow is set because query has grown since; an extended query can
+ * only occur where the shorter one did, so each slide is searched from
+ * its previous match on; returns the first match from the slide the
+ * search started on, wrapping around, or -1 */
+int
+searchupdate(int narrow)
+{
+	uint64_t mask = foldmask(query, querylen);
+	size_t off;
+	int i, n = 0;
+
+	if (!querylen) {
+		nmatches = 0;
+		matchedto = slidecount;
+		return -1;
+	}
+	indexslides(INT_MAX);
+	if (matchcap < slidecount) {
+		int *newmatches;
+		size_t *newoffs;
+
+		if (!(newmatches = realloc(matches, slidecount * sizeof(*matches))) ||
+		    !(newoffs = realloc(matchoffs, slidecount * sizeof(*matchoffs))))
+			die("sent: Unable to reallocate %zu bytes:",
+			    slidecount * sizeof(*matchoffs));
+		matches = newmatches;
+		matchoffs = newoffs;
+		matchcap = slidecount;
+	}
+	if (narrow) {
+		for (i = 0; i < nmatches; i++) {
+			off = matchoffs[i];
+			if (slidematches(&slides[matches[i]], mask, &off)) {
+				matches[n] = matches[i];
+				matchoffs[n++] = off;
+			}
+		}
+	}
+	/* slides that arrived on the input stream since are checked fully */
+	for (i = narrow ? matchedto : 0; i < slidecount; i++) {
+		off = 0;
+		if (slidematches(&slides[i], mask, &off)) {
+			matches[n] = i;
+			matchoffs[n++] = off;
+		}
+	}
+	nmatches = n;
+	matchedto = slidecount;
+
+	for (i = 0; i < nmatches; i++)
+		if (matches[i] >= searchfrom)
+			return matches[i];
+	return nmatches ? matches[0] : -1;
+}
+
+static void
+seek(int i)
+{
+	if (i < 0 || i >= slidecount || i == idx)
+		return;
+	if (slides[idx].img)
+		slides[idx].img->state &= ~SCALED;
+	idx = i;
+}
+
+void
+search(const Arg *arg)
+{
+	if (!slidecount)
+		return;
+	searching = 1;
+	searchfrom = idx;
+	querylen = 0;
+	nmatches = 0;
+	xdraw();
+}
+
+/* leave the search on the current match, or go back if arg->i is 0 */
+void
+searchend(const Arg *arg)
+{
+	searching = 0;
+	if (!arg->i)
+		seek(searchfrom);
+	xdraw();
+}
+
+/* cycle through the matches */
+void
+searchnext(const Arg *arg)
+{
+	int i;
+
+	if (matchedto < slidecount)
+		searchupdate(1);
+	if (!nmatches)
+		return;
+	for (i = 0; i < nmatches && matches[i] < idx; i++)
+		;
+	if (i < nmatches && matches[i] == idx)
+		i += arg->i;
+	else if (arg->i < 0)
+		i--;
+	seek(matches[(i % nmatches + nmatches) % nmatches]);
+	xdraw();
+}
+
+void
+searchdel(const Arg *arg)
+{
+	Arg a = { .i = 0 };
+	int n;
+
+	if (!querylen) {
+		searchend(&a);
+		return;
+	}
+	querylen--;
+	/* an empty query drops the matches of the one deleted */
+	n = searchupdate(0);
+	seek(querylen ? n : searchfrom);
+	xdraw();
+}
+
+/* append typed text to the query and jump to the first match */
+static void
+searchtype(XKeyEvent *e)
+{
+	char buf[32];
+	int i, n, narrow = querylen > 0;
+
+	n = XLookupString(e, buf, sizeof(buf), NULL, NULL);
+	for (i = 0; i < n; i++) {
+		/* Latin-1 input would never match UTF-8 text */
+		if ((unsigned char)buf[i] < ' ' || (unsigned char)buf[i] > '~' ||
+		    querylen == sizeof(query))
+			return;
+		query[querylen++] = fold(buf[i]);
+	}
+	if (n) {
+		seek(searchupdate(narrow));
+		xdraw();
+	}
+}
+
+/* the query and match count in a bar along the bottom of the window */
+void
+searchdraw(void)
+{
+	char buf[sizeof(query) + 32];
+	int i, n, h = xw.h / 20;
+
+	drw_setfontset(d, fontat(REFFONTSIZE * h / refh, 0));
+	h = d->fonts->h * 3 / 2;
+
+	n = snprintf(buf, sizeof(buf), "/%.*s", (int)querylen, query);
+	for (i = 0; i < nmatches && matches[i] != idx; i++)
+		;
+	if (querylen && !nmatches)
+		snprintf(buf + n, sizeof(buf) - n, "  (no match)");
+	else if (querylen)
+		snprintf(buf + n, sizeof(buf) - n, "  (%d/%d)",
+		         i < nmatches ? i + 1 : 0, nmatches);
+	drw_text(d, 0, xw.h - h, xw.w, h, d->fonts->h / 2, buf, 1);
+}
+
+/* render every slide into farbfeld files, spread over forked jobs */
+void
+export(void)
+{
+	int i, status, failed = 0;
+
+	if (mkdir(exportdir, 0777) < 0 && errno != EEXIST)
+		die("sent: Unable to create '%s':", exportdir);
+
+	if (exportjobs <= 0 && (exportjobs = sysconf(_SC_NPROCESSORS_ONLN)) <= 0)
+		exportjobs = 1;
+	LIMIT(exportjobs, 1, slidecount);
+
+	/* each job needs its own display connection, so fork before xinit */
+	for (i = 0; i < exportjobs; i++) {
+		switch (fork()) {
+		case -1:
+			die("sent: Unable to fork:");
+		case 0:
+			exportslides(i);
+			_exit(0);
+		}
+	}
+	while (wait(&status) > 0)
+		if (!WIFEXITED(status) || WEXITSTATUS(status))
+			failed = 1;
+	if (failed)
+		die("sent: Unable to export all slides");
+}
+
+void
+exportslides(int job)
+{
+	char path[PATH_MAX];
+	FILE *fp;
+	int i, ndigits;
+
+	if (getenv("SENT_TRACE")) {
+		snprintf(path, sizeof(path), "%s.%d", getenv("SENT_TRACE"), job);
+		traceopen(path);
+	}
+
+	if (!(xw.dpy = XOpenDisplay(NULL)))
+		die("sent: Unable to open display");
+	xw.scr = XDefaultScreen(xw.dpy);
+	xw.vis = XDefaultVisual(xw.dpy, xw.scr);
+	xinitdrw(XRootWindow(xw.dpy, xw.scr));
+	resize(exportw, exporth);
+	decodew = exportw;
+	decodeh = exporth;
+
+	for (ndigits = 1, i = slidecount; i >= 10; i /= 10)
+		ndigits++;
+
+	for (i = job; i < slidecount; i += exportjobs) {
+		idx = i;
+		ffload(&slides[i]);
+		ffwait();
+		xdrawslide(&slides[i]);
+		if (snprintf(path, sizeof(path), "%s/%0*d.ff", exportdir,
+		             ndigits, i + 1) >= sizeof(path))
+			die("sent: Export path too long");
+		if (!(fp = fopen(path, "w")))
+			die("sent: Unable to open '%s' for writing:", path);
+		ffwrite(fp);
+		if (fclose(fp))
+			die("sent: Unable to write '%s':", path);
+		fffreeslide(&slides[i]);
+	}
+	cleanup(0);
+	traceclose();
+}
+
+void
+quit(const Arg *arg)
+{
+	running = 0;
+}
+
+void
+resize(int width, int height)
+{
+	xw.w = width;
+	xw.h = height;
+	xw.uw = usablewidth * width;
+	xw.uh = usableheight * height;
+	drw_resize(d, width, height);
+}
+
+/* the earlier of two poll() timeouts, -1 standing for none */
+static int
+mintimeout(int a, int b)
+{
+	return a < 0 ? b : b < 0 ? a : MIN(a, b);
+}
+
+/* milliseconds until the kiosk timer advances, or -1 */
+static int
+kiosktimeout(void)
+{
+	double dt;
+
+	if (!kiosk || kioskidx < 0 || slidecount < 2)
+		return -1;
+	dt = kiosknext - monotime();
+	return dt > 0 ? (int)(dt * 1000) + 1 : 0;
+}
+
+/* advance to the next slide, after the last to the first one, once the
+ * current one has been shown for kiosk seconds; showing another slide
+ * starts over, and the overview and search stop the timer */
+static void
+kiosktick(void)
+{
+	if (!kiosk || ovopen || searching) {
+		kioskidx = -1;
+		return;
+	}
+	if (idx != kioskidx) {
+		kioskidx = idx;
+		kiosknext = monotime() + kiosk;
+	} else if (!kiosktimeout()) {
+		advance(&(Arg){ .i = idx + 1 < slidecount ? 1 : -idx });
+	}
+}
+
+/* listen for commands on the UNIX socket path, taking it over from an
+ * earlier instance only if that one is gone */
+static void
+ctlopen(const char *path)
+{
+	struct sockaddr_un sa = { .sun_family = AF_UNIX };
+	struct stat st;
+	mode_t mask;
+	int i, fd;
+
+	if (strlen(path) >= sizeof(sa.sun_path))
+		die("sent: Socket path too long: '%s'", path);
+	strcpy(sa.sun_path, path);
+
+	if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+		die("sent: Unable to create socket:");
+	if (!connect(fd, (struct sockaddr *)&sa, sizeof(sa)))
+		die("sent: Socket '%s' is in use", path);
+	close(fd);
+	/* only a stale socket of an earlier run is replaced */
+	if (!lstat(path, &st)) {
+		if (!S_ISSOCK(st.st_mode))
+			die("sent: '%s' exists and is not a socket", path);
+		unlink(path);
+	}
+
+	if ((ctlfd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+		die("sent: Unable to create socket:");
+	/* the socket is private from the moment it exists */
+	mask = umask(077);
+	i = bind(ctlfd, (struct sockaddr *)&sa, sizeof(sa));
+	umask(mask);
+	if (i < 0)
+		die("sent: Unable to bind socket '%s':", path);
+	if (chmod(path, 0600) < 0)
+		die("sent: Unable to chmod socket '%s':", path);
+	if (listen(ctlfd, MAXCLIENTS) < 0)
+		die("sent: Unable to listen on socket '%s':", path);
+	fcntl(ctlfd, F_SETFD, FD_CLOEXEC);
+	fcntl(ctlfd, F_SETFL, O_NONBLOCK);
+	ctlpath = path;
+
+	for (i = 0; i < MAXCLIENTS; i++)
+		clients[i].fd = -1;
+	/* clients that hang up before their reply must not kill us */
+	signal(SIGPIPE, SIG_IGN);
+}
+
+static void
+ctldrop(Client *c)
+{
+	close(c->fd);
+	c->fd = -1;
+	c->len = 0;
+}
+
+void
+ctlclose(void)
+{
+	int i;
+
+	if (ctlfd < 0)
+		return;
+	for (i = 0; i < MAXCLIENTS; i++)
+		if (clients[i].fd >= 0)
+			ctldrop(&clients[i]);
+	close(ctlfd);
+	unlink(ctlpath);
+	ctlfd = -1;
+}
+
+static void
+ctlreply(Client *c, const char *fmt, ...)
+{
+	char buf[128];
+	va_list ap;
+	int n;
+
+	va_start(ap, fmt);
+	n = vsnprintf(buf, sizeof(buf), fmt, ap);
+	va_end(ap);
+	n = MIN(n, (int)sizeof(buf) - 1);
+	/* replies are small, a client not taking them is dropped */
+	if (write(c->fd, buf, n) != n)
+		ctldrop(c);
+}
+
+/* run one command line: next, prev, goto N, reload or state */
+static void
+ctlcommand(Client *c, char *line)
+{
+	char *arg, *end;
+	long n;
+
+	if (!inputtime)
+		TRACEBEGIN(inputtime);
+	if ((arg = strchr(line, ' ')))
+		*arg++ = '\0';
+
+	if (!strcmp(line, "next") || !strcmp(line, "prev")) {
+		advance(&(Arg){ .i = line[0] == 'n' ? +1 : -1 });
+		ctlreply(c, "ok %d\n", idx + 1);
+	} else if (!strcmp(line, "goto") && arg) {
+		n = strtol(arg, &end, 10);
+		if (*end || n < 1 || n > slidecount) {
+			ctlreply(c, "error no slide %s\n", arg);
+			return;
+		}
+		if (n - 1 != idx) {
+			seek(n - 1);
+			xdraw();
+		}
+		ctlreply(c, "ok %d\n", idx + 1);
+	} else if (!strcmp(line, "reload")) {
+		if (!fname || streamfd >= 0) {
+			ctlreply(c, "error not reading from a file\n");
+			return;
+		}
+		reload(NULL);
+		ctlreply(c, "ok %d\n", idx + 1);
+	} else if (!strcmp(line, "state")) {
+		ctlreply(c, "ok %d %d\n", slidecount ? idx + 1 : 0, slidecount);
+	} else {
+		ctlreply(c, "error unknown command\n");
+	}
+}
+
+/* poll descriptors of the control socket and its clients, unused ones
+ * are negative; returns their number */
+static int
+ctlpollfds(struct pollfd *pfd)
+{
+	int i;
+
+	pfd[0].fd = ctlfd;
+	pfd[0].events = POLLIN;
+	for (i = 0; i < MAXCLIENTS; i++) {
+		pfd[i + 1].fd = ctlfd < 0 ? -1 : clients[i].fd;
+		pfd[i + 1].events = POLLIN;
+	}
+	return MAXCLIENTS + 1;
+}
+
+/* accept connections and run the commands that have arrived; returns
+ * whether anything happened */
+static int
+ctlpump(struct pollfd *pfd)
+{
+	Client *c;
+	char *nl;
+	ssize_t n;
+	int i, fd, changed = 0;
+
+	if (ctlfd < 0)
+		return 0;
+	for (i = 0; i < MAXCLIENTS; i++) {
+		c = &clients[i];
+		if (c->fd < 0 || !pfd[i + 1].revents)
+			continue;
+		changed = 1;
+		if ((n = read(c->fd, c->buf + c->len, sizeof(c->buf) - c->len)) <= 0) {
+			if (n < 0 && (errno == EAGAIN || errno == EINTR))
+				continue;
+			ctldrop(c);
+			continue;
+		}
+		c->len += n;
+		while (c->fd >= 0 && (nl = memchr(c->buf, '\n', c->len))) {
+			*nl = '\0';
+			if (nl > c->buf && nl[-1] == '\r')
+				nl[-1] = '\0';
+			ctlcommand(c, c->buf);
+			c->len -= nl + 1 - c->buf;
+			memmove(c->buf, nl + 1, c->len);
+		}
+		if (c->fd >= 0 && c->len == sizeof(c->buf)) {
+			ctlreply(c, "error line too long\n");
+			c->len = 0;
+		}
+	}
+	if (pfd[0].revents & POLLIN) {
+		while ((fd = accept(ctlfd, NULL, NULL)) >= 0) {
+			for (i = 0; i < MAXCLIENTS && clients[i].fd >= 0; i++)
+				;
+			if (i == MAXCLIENTS) {
+				close(fd);
+				continue;
+			}
+			fcntl(fd, F_SETFD, FD_CLOEXEC);
+			fcntl(fd, F_SETFL, O_NONBLOCK);
+			clients[i].fd = fd;
+			clients[i].len = 0;
+		}
+		changed = 1;
+	}
+	return changed;
+}
+
+void
+run()
+{
+	struct pollfd *pfd = ecalloc(3 + MAXCLIENTS + MAX(maxfilters, 1),
+	                             sizeof(*pfd));
+	XEvent ev;
+	int n, nctl, r, cmd, timeout;
+
+	/* Waiting for window mapping */
+	while (1) {
+		XNextEvent(xw.dpy, &ev);
+		if (ev.type == ConfigureNotify) {
+			resize(ev.xconfigure.width, ev.xconfigure.height);
+		} else if (ev.type == MapNotify) {
 			break;
 		}
-		regfree(&regex);
 	}
-	if (!bin)
-		die("sent: Unable to find matching filter for '%s'", filename);
-
-	if ((fdin = open(filename, O_RDONLY)) < 0)
-		die("sent: Unable to open '%s':", filename);
 
-	if ((fdout = filter(fdin, bin)) < 0)
-		die("sent: Unable to filter '%s':", filename);
-	close(fdin);
-
-	if (read(fdout, hdr, 16) != 16)
-		die("sent: Unable to read filtered file '%s':", filename);
-	if (memcmp("farbfeld", hdr, 8))
-		die("sent: Filtered file '%s' has no valid farbfeld header", filename);
+	while (running) {
+		if (statsreq) {
+			statsreq = 0;
+			dumpstats(NULL);
+		}
+		while (running && XPending(xw.dpy)) {
+			XNextEvent(xw.dpy, &ev);
+			if (handler[ev.type])
+				(handler[ev.type])(&ev);
+			busy = 1;
+		}
+		if (!running)
+			break;
 
-	s->img = ecalloc(1, sizeof(Image));
-	s->img->bufwidth = ntohl(*(uint32_t *)&hdr[8]);
-	s->img->bufheight = ntohl(*(uint32_t *)&hdr[12]);
+		/* only the latest state is drawn, once the server has caught up
+		 * with the previous frame */
+		if (dirty && !inflight)
+			xframe();
+
+		/* the next frame of an animated slide and the kiosk timer are
+		 * due at times of their own, so they set the timeout along
+		 * with the filters */
+		animsync();
+		kiosktick();
+		timeout = mintimeout(fftimeout(), animtimeout());
+		timeout = mintimeout(timeout, kiosktimeout());
+
+		pfd[0].fd = ConnectionNumber(xw.dpy);
+		pfd[0].events = POLLIN;
+		pfd[1].fd = streamfd;
+		pfd[1].events = POLLIN;
+		nctl = ctlpollfds(pfd + 2);
+		n = ffpollfds(pfd + 2 + nctl);
+		if ((r = poll(pfd, 2 + nctl + n, busy ? 0 : timeout)) < 0) {
+			if (errno == EINTR)
+				continue;
+			die("sent: Unable to poll:");
+		}
 
-	if (s->img->buf)
-		free(s->img->buf);
-	/* internally the image is stored in 888 format */
-	s->img->buf = ecalloc(s->img->bufwidth * s->img->bufheight, strlen("888"));
+		/* remote commands are run right away, they are drawn with the
+		 * next frame just like key presses */
+		cmd = ctlpump(pfd + 2);
 
-	/* scratch buffer to read row by row */
-	rowlen = s->img->bufwidth * 2 * strlen("RGBA");
-	row = ecalloc(1, rowlen);
-
-	/* extract window background color channels for transparency */
-	bg_r = (sc[ColBg].pixel >> 16) % 256;
-	bg_g = (sc[ColBg].pixel >>  8) % 256;
-	bg_b = (sc[ColBg].pixel >>  0) % 256;
-
-	for (off = 0, y = 0; y < s->img->bufheight; y++) {
-		size_t nbytes = 0;
-		while (nbytes < rowlen) {
-			count = read(fdout, (char *)row + nbytes, rowlen - nbytes);
-			if (count < 0)
-				die("sent: Unable to read from pipe:");
-			nbytes += count;
-		}
-		for (x = 0; x < rowlen / 2; x += 4) {
-			fg_r = ntohs(row[x + 0]) / 257;
-			fg_g = ntohs(row[x + 1]) / 257;
-			fg_b = ntohs(row[x + 2]) / 257;
-			opac = ntohs(row[x + 3]) / 257;
-			/* blend opaque part of image data with window background color to
-			 * emulate transparency */
-			s->img->buf[off++] = (fg_r * opac + bg_r * (255 - opac)) / 255;
-			s->img->buf[off++] = (fg_g * opac + bg_g * (255 - opac)) / 255;
-			s->img->buf[off++] = (fg_b * opac + bg_b * (255 - opac)) / 255;
+		/* images are decoded as their filters' output arrives */
+		busy = ffpump(pfd + 2 + nctl, n) || cmd;
+		if (pfd[1].revents & (POLLIN | POLLHUP | POLLERR)) {
+			readstream();
+			busy = 1;
 		}
-	}
+		animtick();
 
-	free(row);
-	close(fdout);
+		/* the next frame, thumbnails, mip levels and the search index
+		 * are made while there is nothing else to do */
+		if (!r)
+			busy = animidle() || ovidle() || ffidle() ||
+			       indexslides(INDEXBATCH) || busy;
+	}
+	free(pfd);
 }
 
 void
-ffprepare(Image *img)
+xdraw()
 {
-	int depth = DefaultDepth(xw.dpy, xw.scr);
-	int width = xw.uw;
-	int height = xw.uh;
-
-	if (xw.uw * img->bufheight > xw.uh * img->bufwidth)
-		width = img->bufwidth * xw.uh / img->bufheight;
-	else
-		height = img->bufheight * xw.uw / img->bufwidth;
-
-	if (depth < 24)
-		die("sent: Display color depths < 24 not supported");
-
-	if (!(img->ximg = XCreateImage(xw.dpy, CopyFromParent, depth, ZPixmap, 0,
-	                               NULL, width, height, 32, 0)))
-		die("sent: Unable to create XImage");
-
-	img->ximg->data = ecalloc(height, img->ximg->bytes_per_line);
-	if (!XInitImage(img->ximg))
-		die("sent: Unable to initiate XImage");
-
-	ffscale(img);
-	img->state |= SCALED;
+	dirty = 1;
 }
 
+/* draw the window contents and ask the server to acknowledge them with
+ * a PropertyNotify; nothing here waits for a reply */
 void
-ffscale(Image *img)
+xframe()
 {
-	unsigned int x, y;
-	unsigned int width = img->ximg->width;
-	unsigned int height = img->ximg->height;
-	char* newBuf = img->ximg->data;
-	unsigned char* ibuf;
-	unsigned int jdy = img->ximg->bytes_per_line / 4 - width;
-	unsigned int dx = (img->bufwidth << 10) / width;
+	unsigned long seq = XLastKnownRequestProcessed(xw.dpy);
+	double t;
+
+	TRACEBEGIN(frametime);
+	frameinput = inputtime;
+	inputtime = 0;
+	dirty = 0;
+
+	/* anything but the transition itself changing the view ends it */
+	if (transkind && (ovopen || searching || idx != transidx ||
+	    xw.w != transw || xw.h != transh))
+		transend();
+
+	if (ovopen)
+		ovdraw();
+	else if (transkind)
+		transdraw();
+	else if (slidecount)
+		xdrawslide(&slides[idx]);
+	else /* nothing has arrived on the input stream yet */
+		drw_rect(d, 0, 0, xw.w, xw.h, 1, 1);
+	if (searching)
+		searchdraw();
+
+	TRACEBEGIN(t);
+	drw_map(d, xw.win, 0, 0, xw.w, xw.h);
+	TRACEEND("drw_map", t, idx);
+	XChangeProperty(xw.dpy, xw.win, xw.sentframe, XA_CARDINAL, 32,
+	                PropModeReplace, NULL, 0);
+	XFlush(xw.dpy);
+	inflight = 1;
 
-	for (y = 0; y < height; y++) {
-		unsigned int bufx = img->bufwidth / width;
-		ibuf = &img->buf[y * img->bufheight / height * img->bufwidth * 3];
+	/* the next step goes out once the server has shown this one */
+	if (transkind)
+		dirty = 1;
 
-		for (x = 0; x < width; x++) {
-			*newBuf++ = (ibuf[(bufx >> 10)*3+2]);
-			*newBuf++ = (ibuf[(bufx >> 10)*3+1]);
-			*newBuf++ = (ibuf[(bufx >> 10)*3+0]);
-			newBuf++;
-			bufx += dx;
-		}
-		newBuf += jdy;
-	}
+	/* the server's sequence number only moves while the client reads
+	 * from it, which no event handling has done since the frame began */
+	TRACECOUNT("roundtrips", XLastKnownRequestProcessed(xw.dpy) != seq);
 }
 
+/* keep the frame shown last to blend it into the slide to; a navigation
+ * while a transition is running ends it instead, so that paging through
+ * quickly is not slowed down */
 void
-ffdraw(Image *img)
+transbegin(int kind, int to)
 {
-	int xoffset = (xw.w - img->ximg->width) / 2;
-	int yoffset = (xw.h - img->ximg->height) / 2;
-	XPutImage(xw.dpy, xw.win, d->gc, img->ximg, 0, 0,
-	          xoffset, yoffset, img->ximg->width, img->ximg->height);
-	XFlush(xw.dpy);
+	if (transkind) {
+		transend();
+		return;
+	}
+	if (kind == TransNone || !d || !xw.win || ovopen || searching)
+		return;
+	if (kind == TransFade && !winfmt)
+		kind = TransWipe;
+	transfrom = XCreatePixmap(xw.dpy, d->root, xw.w, xw.h,
+	                          DefaultDepth(xw.dpy, xw.scr));
+	XCopyArea(xw.dpy, d->drawable, transfrom, d->gc, 0, 0, xw.w, xw.h, 0, 0);
+	transkind = kind;
+	transdir = to > idx ? 1 : -1;
+	transidx = to;
+	transw = xw.w;
+	transh = xw.h;
 }
 
 void
-getfontsize(Slide *s, unsigned int *width, unsigned int *height)
+transend(void)
 {
-	int i, j;
-	float lfac = linespacing * (s->linecount - 1) + 1;
-
-	/* fit height */
-	for (j = NUMFONTSCALES - 1; j >= 0; j--)
-		if (fonts[j]->h * lfac <= xw.uh)
-			break;
-	LIMIT(j, 0, NUMFONTSCALES - 1);
-	drw_setfontset(d, fonts[j]);
-
-	/* fit width */
-	*width = 0;
-	for (i = 0; i < s->linecount; i++) {
-		unsigned int curw = drw_fontset_getwidth(d, s->lines[i]);
-		const unsigned int newmax = (curw >= *width);
-		while (j > 0 && curw > xw.uw) {
-			drw_setfontset(d, fonts[--j]);
-			curw = drw_fontset_getwidth(d, s->lines[i]);
-		}
-		if (newmax)
-			*width = curw;
-	}
-	*height = fonts[j]->h * lfac;
+	if (!transkind)
+		return;
+	if (transtopic)
+		XRenderFreePicture(xw.dpy, transtopic);
+	if (transto)
+		XFreePixmap(xw.dpy, transto);
+	XFreePixmap(xw.dpy, transfrom);
+	transtopic = None;
+	transto = transfrom = None;
+	transkind = TransNone;
 }
 
+/* draw the next step of the transition into the drawing buffer; the
+ * incoming slide is rendered once at the start and once more at the end,
+ * in between the server only copies and blends the two frames */
 void
-cleanup(int slidesonly)
+transdraw(void)
 {
-	if (!slidesonly) {
-		for (unsigned int i = 0; i < NUMFONTSCALES; i++)
-			drw_fontset_free(fonts[i]);
-		free(sc);
-		drw_free(d);
-
-		XDestroyWindow(xw.dpy, xw.win);
-		XSync(xw.dpy, False);
-		XCloseDisplay(xw.dpy);
+	XRenderColor alpha = { 0 };
+	Picture mask, dst;
+	int w = xw.w, h = xw.h, off;
+	double p, t;
+
+	if (!transto) {
+		xdrawslide(&slides[idx]);
+		transto = XCreatePixmap(xw.dpy, d->root, w, h,
+		                        DefaultDepth(xw.dpy, xw.scr));
+		XCopyArea(xw.dpy, d->drawable, transto, d->gc, 0, 0, w, h, 0, 0);
+		if (transkind == TransFade)
+			transtopic = XRenderCreatePicture(xw.dpy, transto, winfmt, 0, NULL);
+		transstart = monotime();
+	}
+	if ((p = (monotime() - transstart) / MAX(transitiontime, 0.001)) >= 1) {
+		transend();
+		xdrawslide(&slides[idx]);
+		return;
 	}
 
-	if (slides) {
-		for (unsigned int i = 0; i < slidecount; i++) {
-			for (unsigned int j = 0; j < slides[i].linecount; j++)
-				free(slides[i].lines[j]);
-			free(slides[i].lines);
-			if (slides[i].img)
-				fffree(slides[i].img);
+	TRACEBEGIN(t);
+	p = p * p * (3 - 2 * p); /* ease in and out */
+	off = p * w;
+	switch (transkind) {
+	case TransFade:
+		XCopyArea(xw.dpy, transfrom, d->drawable, d->gc, 0, 0, w, h, 0, 0);
+		alpha.alpha = p * 0xFFFF;
+		mask = XRenderCreateSolidFill(xw.dpy, &alpha);
+		dst = XRenderCreatePicture(xw.dpy, d->drawable, winfmt, 0, NULL);
+		XRenderComposite(xw.dpy, PictOpOver, transtopic, mask, dst,
+		                 0, 0, 0, 0, 0, 0, w, h);
+		XRenderFreePicture(xw.dpy, dst);
+		XRenderFreePicture(xw.dpy, mask);
+		break;
+	case TransSlide:
+		/* the old slide is pushed out by the new one */
+		if (transdir > 0) {
+			XCopyArea(xw.dpy, transfrom, d->drawable, d->gc,
+			          off, 0, w - off, h, 0, 0);
+			XCopyArea(xw.dpy, transto, d->drawable, d->gc,
+			          0, 0, off, h, w - off, 0);
+		} else {
+			XCopyArea(xw.dpy, transfrom, d->drawable, d->gc,
+			          0, 0, w - off, h, off, 0);
+			XCopyArea(xw.dpy, transto, d->drawable, d->gc,
+			          w - off, 0, off, h, 0, 0);
 		}
-		if (!slidesonly) {
-			free(slides);
-			slides = NULL;
+		break;
+	case TransWipe:
+		/* the new slide is uncovered in place */
+		if (transdir > 0) {
+			XCopyArea(xw.dpy, transfrom, d->drawable, d->gc,
+			          0, 0, w - off, h, 0, 0);
+			XCopyArea(xw.dpy, transto, d->drawable, d->gc,
+			          w - off, 0, off, h, w - off, 0);
+		} else {
+			XCopyArea(xw.dpy, transto, d->drawable, d->gc,
+			          0, 0, off, h, 0, 0);
+			XCopyArea(xw.dpy, transfrom, d->drawable, d->gc,
+			          off, 0, w - off, h, off, 0);
 		}
+		break;
 	}
+	TRACEEND("transition", t, idx);
 }
 
+/* render a slide into the off-screen drawing buffer */
 void
-reload(const Arg *arg)
+xdrawslide(Slide *s)
 {
-	FILE *fp = NULL;
-	unsigned int i;
-
-	if (!fname) {
-		fprintf(stderr, "sent: Cannot reload from stdin. Use a file!\n");
-		return;
+	unsigned int height, width;
+	Image *im = s->img;
+	double t;
+
+	drw_rect(d, 0, 0, xw.w, xw.h, 1, 1);
+
+	/* images not decoded (yet) show their name in an outline */
+	if (im && !ffready(im))
+		drw_rect(d, (xw.w - xw.uw) / 2, (xw.h - xw.uh) / 2, xw.uw, xw.uh, 0, 0);
+	if (!im || !ffready(im)) {
+		/* only text is fitted, images need no fonts */
+		TRACEBEGIN(t);
+		getfontsize(s, &width, &height);
+		TRACEEND("getfontsize", t, slideidx(s));
+		TRACEBEGIN(t);
+		for (unsigned int i = 0; i < s->linecount; i++)
+			drw_text(d,
+			         (xw.w - width) / 2,
+			         (xw.h - height) / 2 + i * linespacing * d->fonts->h,
+			         width,
+			         d->fonts->h,
+			         0,
+			         s->lines[i],
+			         0);
+		TRACEEND("drw_text", t, slideidx(s));
+	} else {
+		if (!(im->state & SCALED))
+			ffprepare(im);
+		ffdraw(im);
 	}
+}
 
-	cleanup(1);
-	slidecount = 0;
+/* grid geometry: columns, tile size and the thumbnail size within */
+static void
+ovlayout(int *cols, int *tilew, int *tileh, int *tw, int *th)
+{
+	*cols = MAX(overviewcols, 1);
+	*tilew = MAX(xw.w / *cols, 1);
+	*tileh = MAX(*tilew * xw.h / MAX(xw.w, 1), 1);
+	*tw = MAX(*tilew - *tilew / 8, 1);
+	*th = MAX(*tileh - *tilew / 8, 1);
+}
 
-	if (!(fp = fopen(fname, "r")))
-		die("sent: Unable to open '%s' for reading:", fname);
-	load(fp);
-	fclose(fp);
+void
+ovfree(void)
+{
+	int i;
 
-	LIMIT(idx, 0, slidecount-1);
-	for (i = 0; i < slidecount; i++)
-		ffload(&slides[i]);
-	xdraw();
+	for (i = 0; i < thumbcount; i++) {
+		if (thumbs[i])
+			XFreePixmap(xw.dpy, thumbs[i]);
+		thumbs[i] = None;
+	}
 }
 
-/**
- * Skips the Byte Order Mark (BOM), if present.
- * In a text file, "UTF-8 (with BOM)" formatting is indicated
- * by a BOM (<U+FEFF>) appearing in the beginning of the file.
- * We check for it, by checking whether the first three characters.
- * If no BOM is present, we rewind the file pointer
- * to the begining of the file, otherwise not,
- * in order to exclude the BOM from the content of the file.
- */
-static void
-skipBom(FILE *fp)
+/* render slide i into a new pixmap of the thumbnail size */
+static Pixmap
+ovthumb(int i)
 {
-	int c1, c2, c3;
-
-	c1 = fgetc(fp);
-	c2 = (c1 == EOF) ? EOF : fgetc(fp);
-	c3 = (c2 == EOF) ? EOF : fgetc(fp);
-	if (!(c1 == 0xEF && c2 == 0xBB && c3 == 0xBF))
-	{
-		rewind(fp);
+	XWindow saved = xw;
+	Image *im = slides[i].img;
+	XImage *ximg;
+	Pixmap pm;
+	int width, height;
+	double t;
+
+	TRACEBEGIN(t);
+	/* few sizes for the many small slides of the grid */
+	fontthumb = 1;
+	xw.w = thumbw;
+	xw.h = thumbh;
+	xw.uw = usablewidth * thumbw;
+	xw.uh = usableheight * thumbh;
+	if (im && ffready(im)) {
+		/* the image's own XImage stays scaled for the presentation */
+		drw_rect(d, 0, 0, xw.w, xw.h, 1, 1);
+		fffit(im, &width, &height);
+		ximg = ffximage(width, height);
+		ffscaleto(im, ximg);
+		XPutImage(xw.dpy, d->drawable, d->gc, ximg, 0, 0,
+		          (xw.w - width) / 2, (xw.h - height) / 2, width, height);
+		ximgdestroy(ximg);
+	} else {
+		xdrawslide(&slides[i]);
 	}
+	pm = XCreatePixmap(xw.dpy, xw.win, thumbw, thumbh,
+	                   DefaultDepth(xw.dpy, xw.scr));
+	XCopyArea(xw.dpy, d->drawable, pm, d->gc, 0, 0, thumbw, thumbh, 0, 0);
+	xw = saved;
+	fontthumb = 0;
+	TRACEEND("thumbnail", t, i);
+	return pm;
 }
 
+/* draw the grid from cached thumbnails into the off-screen drawing
+ * buffer, missing ones are outlined and rendered by ovidle() */
 void
-load(FILE *fp)
+ovdraw(void)
 {
-	static size_t size = 0;
-	unsigned blen;
-	char buf[BUFSIZ];
-	Slide *s;
+	int cols, tilew, tileh, tw, th, rows, vis, row, x, y, i, j;
 
-	skipBom(fp);
-
-	/* read each line from fp and add it to the item list */
-	while (1) {
-		char* p;
-		/* eat consecutive empty lines */
-		while ((p = fgets(buf, sizeof(buf), fp)))
-			if (strcmp(buf, "\n") != 0 && buf[0] != '#')
-				break;
-		if (!p)
-			break;
+	ovlayout(&cols, &tilew, &tileh, &tw, &th);
+	if (tw != thumbw || th != thumbh) {
+		ovfree();
+		thumbw = tw;
+		thumbh = th;
+	}
+	if (thumbcount < slidecount) {
+		Pixmap *newthumbs;
+
+		if (!(newthumbs = realloc(thumbs, slidecount * sizeof(*thumbs))))
+			die("sent: Unable to reallocate %zu bytes:",
+			    slidecount * sizeof(*thumbs));
+		thumbs = newthumbs;
+		for (; thumbcount < slidecount; thumbcount++)
+			thumbs[thumbcount] = None;
+	}
 
-		if ((slidecount + 1) * sizeof(*slides) >= size) {
-			Slide* newSlides = NULL;
-			if (!(newSlides = realloc(slides, (size += BUFSIZ)))) {
-				die("sent: Unable to reallocate %u bytes:", size);
-			} else {
-				slides = newSlides;
-			}
-		}
+	/* scroll the selected slide into view */
+	rows = (slidecount + cols - 1) / cols;
+	vis = MAX(xw.h / tileh, 1);
+	row = idx / cols;
+	if (row < ovtop)
+		ovtop = row;
+	else if (row >= ovtop + vis)
+		ovtop = row - vis + 1;
+	LIMIT(ovtop, 0, MAX(rows - vis, 0));
+
+	drw_rect(d, 0, 0, xw.w, xw.h, 1, 1);
+	for (i = ovtop * cols; i < slidecount && i < (ovtop + vis) * cols; i++) {
+		x = (i % cols) * tilew + (tilew - tw) / 2;
+		y = (xw.h - MIN(rows, vis) * tileh) / 2 +
+		    (i / cols - ovtop) * tileh + (tileh - th) / 2;
+		if (thumbs[i])
+			XCopyArea(xw.dpy, thumbs[i], d->drawable, d->gc, 0, 0,
+			          tw, th, x, y);
+		else
+			drw_rect(d, x, y, tw, th, 0, 0);
+		if (i == idx)
+			for (j = 1; j <= 3; j++)
+				drw_rect(d, x - j, y - j, tw + 2 * j, th + 2 * j, 0, 0);
+	}
+}
 
-		/* read one slide */
-		unsigned maxlines = 0;
-		memset((s = &slides[slidecount]), 0, sizeof(Slide));
-		do {
-			/* if there's a leading null, we can't do blen-1 */
-			if (buf[0] == '\0')
-				continue;
+/* render one missing thumbnail of the visible part of the grid; returns
+ * 0 once there is none left */
+int
+ovidle(void)
+{
+	int cols, tilew, tileh, tw, th, vis, i;
 
-			if (buf[0] == '#')
-				continue;
+	if (!ovopen || !slidecount)
+		return 0;
+	/* the grid has not been drawn at this size yet */
+	ovlayout(&cols, &tilew, &tileh, &tw, &th);
+	if (tw != thumbw || th != thumbh)
+		return 0;
+	vis = MAX(xw.h / tileh, 1);
+	for (i = ovtop * cols; i < slidecount && i < thumbcount &&
+	     i < (ovtop + vis) * cols; i++) {
+		if (!thumbs[i]) {
+			thumbs[i] = ovthumb(i);
+			xdraw();
+			return 1;
+		}
+	}
+	return 0;
+}
 
-			/* grow lines array */
-			if (s->linecount >= maxlines) {
-				maxlines = 2 * s->linecount + 1;
-				if (!(s->lines = realloc(s->lines, maxlines * sizeof(s->lines[0]))))
-					die("sent: Unable to reallocate %u bytes:", maxlines * sizeof(s->lines[0]));
-			}
+/* bytes per pixel of pixmaps on the screen */
+static size_t
+pixbytes(void)
+{
+	return DefaultDepth(xw.dpy, xw.scr) > 16 ? 4 : 2;
+}
 
-			blen = strlen(buf);
-			if (!(s->lines[s->linecount] = strdup(buf)))
-				die("sent: Unable to strdup:");
-			if (s->lines[s->linecount][blen-1] == '\n')
-				s->lines[s->linecount][blen-1] = '\0';
+/* add the memory held for img to m, indexed by Mem*; pixels mapped from
+ * a compiled deck are not counted */
+static void
+ffmemory(Image *img, size_t *m)
+{
+	int i;
 
-			/* mark as image slide if first line of a slide starts with @ */
-			if (s->linecount == 0 && s->lines[0][0] == '@')
-				s->embed = &s->lines[0][1];
+	if (img->buf && !(img->state & MAPPED))
+		m[MemDecoded] += (size_t)img->bufwidth * img->bufheight * bufbpp(img);
+	for (i = 0; i < img->nmips + (img->miprow > 0); i++)
+		m[MemMips] += (size_t)img->mipw[i] * img->miph[i] * bufbpp(img);
+	if (img->ximg)
+		m[MemScaled] += (size_t)img->ximg->bytes_per_line * img->ximg->height;
+	if (img->pic)
+		m[MemServer] += img->picfixed ? (size_t)img->picw * img->pich * 2 :
+		                (size_t)img->bufwidth * img->bufheight * 4;
+}
 
-			if (s->lines[s->linecount][0] == '\\')
-				memmove(s->lines[s->linecount], &s->lines[s->linecount][1], blen);
-			s->linecount++;
-		} while ((p = fgets(buf, sizeof(buf), fp)) && strcmp(buf, "\n") != 0);
+/* print the memory of every slide with an image and of each subsystem,
+ * along with timings and cache hit rates, to stderr */
+void
+dumpstats(const Arg *arg)
+{
+	static const char *memname[MemLast] = {
+		[MemDecoded] = "decoded images",
+		[MemMips] = "mip levels",
+		[MemScaled] = "scaled images",
+		[MemServer] = "images on the server",
+	};
+	size_t m[MemLast], total[MemLast] = { 0 }, idle;
+	unsigned long hits, misses;
+	unsigned int i, k, nfonts = 0, basefonts = 0, nthumbs = 0;
+	Image *img;
+	Slide *s;
+	Fnt *f;
 
-		slidecount++;
-		if (!p)
-			break;
+	fprintf(stderr, "sent: memory in KiB\n");
+	fprintf(stderr, "slide\tdecoded\tmips\tscaled\tserver\timage\n");
+	for (i = 0; i < slidecount; i++) {
+		if (!(s = &slides[i])->img)
+			continue;
+		memset(m, 0, sizeof(m));
+		for (k = 0; k < s->nframes; k++)
+			ffmemory(s->frames[k], m);
+		if (!s->nframes)
+			ffmemory(s->img, m);
+		fprintf(stderr, "%u\t%zu\t%zu\t%zu\t%zu\t%s%s\n", i + 1,
+		        m[MemDecoded] >> 10, m[MemMips] >> 10, m[MemScaled] >> 10,
+		        m[MemServer] >> 10, s->embed,
+		        s->img->refs > 1 ? " (shared)" : "");
 	}
 
-	if (!slidecount)
-		die("sent: No slides in file");
+	/* shared images are counted once */
+	for (img = images; img; img = img->next)
+		ffmemory(img, total);
+	for (i = 0; binhdr && i < binhdr->imagecount; i++)
+		if (binimgs[i] && binimgs[i]->refs)
+			ffmemory(binimgs[i], total);
+	for (i = 0; i < thumbcount; i++)
+		nthumbs += thumbs[i] != None;
+	for (i = 0; i < LEN(fonts); i++) {
+		for (f = fonts[i].set; f; f = f->next)
+			nfonts++;
+		basefonts += fonts[i].base;
+	}
+	poolstats(&idle, &hits, &misses);
+
+	fprintf(stderr, "subsystem\ttotal\n");
+	for (i = 0; i < MemLast; i++)
+		fprintf(stderr, "%s\t%zu\n", memname[i], total[i] >> 10);
+	fprintf(stderr, "idle image buffers\t%zu\n", idle >> 10);
+	fprintf(stderr, "slides\t%zu\n", slidecap * sizeof(Slide) >> 10);
+	fprintf(stderr, "slide text and index\t%zu\n", arenasize(&deck) >> 10);
+	fprintf(stderr, "compiled deck (mapped)\t%zu\n", deckbinlen >> 10);
+	fprintf(stderr, "thumbnails on the server\t%zu\n",
+	        nthumbs * thumbw * thumbh * pixbytes() >> 10);
+	fprintf(stderr, "frame buffers on the server\t%zu\n",
+	        (transkind ? 3 : 1) * xw.w * xw.h * pixbytes() >> 10);
+	fprintf(stderr, "fonts\t%u open, %u fallbacks\n", nfonts,
+	        nfonts - basefonts);
+
+	fprintf(stderr, "timing\tcount\tms avg\n");
+	fprintf(stderr, "decode\t%lu\t%.1f\n", stats.decodes,
+	        stats.decodes ? stats.decodetime * 1e3 / stats.decodes : 0);
+	fprintf(stderr, "scale\t%lu\t%.1f\n", stats.scales,
+	        stats.scales ? stats.scaletime * 1e3 / stats.scales : 0);
+	fprintf(stderr, "upload\t%lu\t%.1f\n", stats.uploads,
+	        stats.uploads ? stats.uploadtime * 1e3 / stats.uploads : 0);
+
+	fprintf(stderr, "cache\thits\tmisses\n");
+	fprintf(stderr, "shared images\t%lu\t%lu\n", stats.imghits, stats.imgmisses);
+	fprintf(stderr, "compiled font fits\t%lu\t%lu\n", stats.fithits,
+	        stats.fitmisses);
+	fprintf(stderr, "font sizes\t%lu\t%lu\n", stats.fonthits,
+	        stats.fontmisses);
+	fprintf(stderr, "image buffers\t%lu\t%lu\n", hits, misses);
 }
 
-void
-advance(const Arg *arg)
+static void
+sigusr1(int sig)
 {
-	int new_idx = idx + arg->i;
-	LIMIT(new_idx, 0, slidecount-1);
-	if (new_idx != idx) {
-		if (slides[idx].img)
-			slides[idx].img->state &= ~SCALED;
-		idx = new_idx;
-		xdraw();
-	}
+	statsreq = 1;
 }
 
+/* switch between colors and altcolors; images are composited onto the
+ * new background as they are drawn, so nothing is decoded again */
 void
-quit(const Arg *arg)
+theme(const Arg *arg)
 {
-	running = 0;
+	Clr *tmp = sc;
+	int i;
+
+	sc = altsc;
+	altsc = tmp;
+	drw_setscheme(d, sc);
+	XSetWindowBackground(xw.dpy, xw.win, sc[ColBg].pixel);
+	for (i = 0; i < slidecount; i++)
+		if (slides[i].img)
+			slides[i].img->state &= ~SCALED;
+	ovfree();
+	xdraw();
 }
 
 void
-resize(int width, int height)
+overview(const Arg *arg)
 {
-	xw.w = width;
-	xw.h = height;
-	xw.uw = usablewidth * width;
-	xw.uh = usableheight * height;
-	drw_resize(d, width, height);
+	if (!slidecount)
+		return;
+	ovopen = !ovopen;
+	xdraw();
 }
 
 void
-run()
+ovrow(const Arg *arg)
 {
-	XEvent ev;
-
-	/* Waiting for window mapping */
-	while (1) {
-		XNextEvent(xw.dpy, &ev);
-		if (ev.type == ConfigureNotify) {
-			resize(ev.xconfigure.width, ev.xconfigure.height);
-		} else if (ev.type == MapNotify) {
-			break;
-		}
-	}
+	int cols = MAX(overviewcols, 1), row = idx / cols + arg->i;
+	Arg a;
 
-	while (running) {
-		XNextEvent(xw.dpy, &ev);
-		if (handler[ev.type])
-			(handler[ev.type])(&ev);
-	}
+	/* a shorter last row is entered at its last slide */
+	LIMIT(row, 0, (slidecount - 1) / cols);
+	a.i = (row - idx / cols) * cols;
+	advance(&a);
 }
 
+/* select the slide under the pointer and leave the overview */
 void
-xdraw()
+ovselect(const Arg *arg)
 {
-	unsigned int height, width;
-	Image *im = slides[idx].img;
+	int cols, tilew, tileh, tw, th, rows, vis, col, row, y0;
 
-	getfontsize(&slides[idx], &width, &height);
-	XClearWindow(xw.dpy, xw.win);
-
-	if (!im) {
-		drw_rect(d, 0, 0, xw.w, xw.h, 1, 1);
-		for (unsigned int i = 0; i < slides[idx].linecount; i++)
-			drw_text(d,
-			         (xw.w - width) / 2,
-			         (xw.h - height) / 2 + i * linespacing * d->fonts->h,
-			         width,
-			         d->fonts->h,
-			         0,
-			         slides[idx].lines[i],
-			         0);
-		drw_map(d, xw.win, 0, 0, xw.w, xw.h);
-	} else {
-		if (!(im->state & SCALED))
-			ffprepare(im);
-		ffdraw(im);
-	}
+	ovlayout(&cols, &tilew, &tileh, &tw, &th);
+	rows = (slidecount + cols - 1) / cols;
+	vis = MAX(xw.h / tileh, 1);
+	y0 = (xw.h - MIN(rows, vis) * tileh) / 2;
+	if (ptry < y0 || (col = ptrx / tilew) >= cols)
+		return;
+	row = ovtop + (ptry - y0) / tileh;
+	if (row * cols + col >= slidecount)
+		return;
+	seek(row * cols + col);
+	ovopen = 0;
+	xdraw();
 }
 
 void
@@ -602,10 +3690,15 @@ xinit()
 	xw.scr = XDefaultScreen(xw.dpy);
 	xw.vis = XDefaultVisual(xw.dpy, xw.scr);
 	resize(DisplayWidth(xw.dpy, xw.scr), DisplayHeight(xw.dpy, xw.scr));
+	for (i = 0; i < ScreenCount(xw.dpy); i++) {
+		decodew = MAX(decodew, DisplayWidth(xw.dpy, i));
+		decodeh = MAX(decodeh, DisplayHeight(xw.dpy, i));
+	}
 
 	xw.attrs.bit_gravity = CenterGravity;
 	xw.attrs.event_mask = KeyPressMask | ExposureMask | StructureNotifyMask |
-	                      ButtonMotionMask | ButtonPressMask;
+	                      ButtonMotionMask | ButtonPressMask |
+	                      PropertyChangeMask;
 
 	xw.win = XCreateWindow(xw.dpy, XRootWindow(xw.dpy, xw.scr), 0, 0,
 	                       xw.w, xw.h, 0, XDefaultDepth(xw.dpy, xw.scr),
@@ -614,15 +3707,12 @@ xinit()
 
 	xw.wmdeletewin = XInternAtom(xw.dpy, "WM_DELETE_WINDOW", False);
 	xw.netwmname = XInternAtom(xw.dpy, "_NET_WM_NAME", False);
+	xw.sentframe = XInternAtom(xw.dpy, "_SENT_FRAME", False);
 	XSetWMProtocols(xw.dpy, xw.win, &xw.wmdeletewin, 1);
 
-	if (!(d = drw_create(xw.dpy, xw.scr, xw.win, xw.w, xw.h)))
-		die("sent: Unable to create drawing context");
-	sc = drw_scm_create(d, colors, 2);
-	drw_setscheme(d, sc);
+	xinitdrw(xw.win);
 	XSetWindowBackground(xw.dpy, xw.win, sc[ColBg].pixel);
 
-	xloadfonts();
 	for (i = 0; i < slidecount; i++)
 		ffload(&slides[i]);
 
@@ -635,38 +3725,82 @@ xinit()
 	XSync(xw.dpy, False);
 }
 
+/* XRender format of 16 bit RGB565 pixmaps, if the server has them */
+static XRenderPictFormat *
+xlowfmt(void)
+{
+	XRenderPictFormat tmpl = { 0 };
+	XPixmapFormatValues *pf;
+	int i, n, ok = 0;
+
+	if ((pf = XListPixmapFormats(xw.dpy, &n))) {
+		for (i = 0; i < n; i++)
+			ok |= pf[i].depth == 16 && pf[i].bits_per_pixel == 16;
+		XFree(pf);
+	}
+	if (!ok)
+		return NULL;
+	tmpl.type = PictTypeDirect;
+	tmpl.depth = 16;
+	tmpl.direct.red = 11;
+	tmpl.direct.redMask = 0x1F;
+	tmpl.direct.green = 5;
+	tmpl.direct.greenMask = 0x3F;
+	tmpl.direct.blue = 0;
+	tmpl.direct.blueMask = 0x1F;
+	return XRenderFindFormat(xw.dpy, PictFormatType | PictFormatDepth |
+	                         PictFormatRed | PictFormatRedMask |
+	                         PictFormatGreen | PictFormatGreenMask |
+	                         PictFormatBlue | PictFormatBlueMask, &tmpl, 0);
+}
+
+/* drawing context, colors and fonts; root is any drawable of the screen */
 void
-xloadfonts()
+xinitdrw(Window root)
 {
-	int i, j;
-	char *fstrs[LEN(fontfallbacks)];
+	int evbase, errbase;
 
-	for (j = 0; j < LEN(fontfallbacks); j++) {
-		fstrs[j] = ecalloc(1, MAXFONTSTRLEN);
-	}
+	if (!(d = drw_create(xw.dpy, xw.scr, root, xw.w, xw.h)))
+		die("sent: Unable to create drawing context");
+	sc = drw_scm_create(d, colors, 2);
+	altsc = drw_scm_create(d, altcolors, 2);
+	drw_setscheme(d, sc);
 
-	for (i = 0; i < NUMFONTSCALES; i++) {
-		for (j = 0; j < LEN(fontfallbacks); j++) {
-			if (MAXFONTSTRLEN < snprintf(fstrs[j], MAXFONTSTRLEN, "%s:size=%d", fontfallbacks[j], FONTSZ(i)))
-				die("sent: Font string too long");
-		}
-		if (!(fonts[i] = drw_fontset_create(d, (const char**)fstrs, LEN(fstrs))))
-			die("sent: Unable to load any font for size %d", FONTSZ(i));
+	/* images are scaled on the server if it can, on the client if not;
+	 * the server would truncate them to 16 bit visuals, so there they
+	 * are dithered by ffscaleto() */
+	if (DefaultDepth(xw.dpy, xw.scr) > 16 &&
+	    XRenderQueryExtension(xw.dpy, &evbase, &errbase)) {
+		imgfmt = XRenderFindStandardFormat(xw.dpy, PictStandardARGB32);
+		if (!(winfmt = XRenderFindVisualFormat(xw.dpy, xw.vis)))
+			imgfmt = NULL;
 	}
+	if (lowbw && imgfmt && DefaultDepth(xw.dpy, xw.scr) > 16)
+		lowfmt = xlowfmt();
 
-	for (j = 0; j < LEN(fontfallbacks); j++)
-		if (fstrs[j])
-			free(fstrs[j]);
+	xloadfonts();
 }
 
+/* other sizes are opened as slides need them */
 void
-bpress(XEvent *e)
+xloadfonts()
 {
-	unsigned int i;
+	refh = fontat(REFFONTSIZE, 0)->h;
+}
 
-	for (i = 0; i < LEN(mshortcuts); i++)
-		if (e->xbutton.button == mshortcuts[i].b && mshortcuts[i].func)
-			mshortcuts[i].func(&(mshortcuts[i].arg));
+void
+bpress(XEvent *e)
+{
+	unsigned int i, n = ovopen ? LEN(ovmshortcuts) : LEN(mshortcuts);
+	Mousekey *m = ovopen ? ovmshortcuts : mshortcuts;
+
+	if (!inputtime)
+		TRACEBEGIN(inputtime);
+	ptrx = e->xbutton.x;
+	ptry = e->xbutton.y;
+	for (i = 0; i < n; i++)
+		if (e->xbutton.button == m[i].b && m[i].func)
+			m[i].func(&(m[i].arg));
 }
 
 void
@@ -686,20 +3820,47 @@ expose(XEvent *e)
 void
 kpress(XEvent *e)
 {
-	unsigned int i;
+	unsigned int i, n = ovopen ? LEN(ovshortcuts) : LEN(shortcuts);
+	Shortcut *k = ovopen ? ovshortcuts : shortcuts;
 	KeySym sym;
+	int bound = 0;
 
+	if (!inputtime)
+		TRACEBEGIN(inputtime);
 	sym = XkbKeycodeToKeysym(xw.dpy, (KeyCode)e->xkey.keycode, 0, 0);
-	for (i = 0; i < LEN(shortcuts); i++)
-		if (sym == shortcuts[i].keysym && shortcuts[i].func)
-			shortcuts[i].func(&(shortcuts[i].arg));
+	if (searching) {
+		k = searchshortcuts;
+		n = LEN(searchshortcuts);
+	}
+	for (i = 0; i < n; i++) {
+		if (sym == k[i].keysym && k[i].func) {
+			k[i].func(&(k[i].arg));
+			bound = 1;
+		}
+	}
+	if (searching && !bound)
+		searchtype(&e->xkey);
+}
+
+/* the server has drawn the frame in flight */
+void
+pnotify(XEvent *e)
+{
+	if (e->xproperty.atom != xw.sentframe || !inflight)
+		return;
+	inflight = 0;
+	TRACEEND("frame", frametime, idx);
+	if (frameinput) {
+		TRACEEND("input-to-frame", frameinput, idx);
+		frameinput = 0;
+	}
 }
 
 void
 configure(XEvent *e)
 {
 	resize(e->xconfigure.width, e->xconfigure.height);
-	if (slides[idx].img)
+	if (slidecount && slides[idx].img)
 		slides[idx].img->state &= ~SCALED;
 	xdraw();
 }
@@ -707,15 +3868,47 @@ configure(XEvent *e)
 void
 usage()
 {
-	die("usage:\n\t%s [file]\n\t%s -h\n\t%s -v", argv0, argv0, argv0);
+	die("usage:\n\t%s [-lL] [-k seconds] [-s socket] [file]\n\t%s -c out [file]\n"
+	    "\t%s -o dir [-L] [-g WxH] [-j jobs] [file]\n\t%s -h\n\t%s -v",
+	    argv0, argv0, argv0, argv0, argv0);
 }
 
 int
 main(int argc, char *argv[])
 {
 	FILE *fp = NULL;
+	struct stat st;
 
+	lowbw = lowbandwidth;
+	linear = linearlight;
 	ARGBEGIN {
+	case 'c':
+		compileout = EARGF(usage());
+		break;
+	case 'g':
+		if (sscanf(EARGF(usage()), "%dx%d", &exportw, &exporth) != 2 ||
+		    exportw <= 0 || exporth <= 0)
+			usage();
+		break;
+	case 'j':
+		exportjobs = atoi(EARGF(usage()));
+		break;
+	case 'k':
+		if ((kiosk = atof(EARGF(usage()))) <= 0)
+			usage();
+		break;
+	case 'l':
+		lowbw = 1;
+		break;
+	case 'L':
+		linear = 1;
+		break;
+	case 'o':
+		exportdir = EARGF(usage());
+		break;
+	case 's':
+		ctlpath = EARGF(usage());
+		break;
 	case 'v':
 		fprintf(stderr, "sent-"VERSION"\n");
 		return 0;
@@ -723,16 +3916,42 @@ main(int argc, char *argv[])
 		usage();
 	} ARGEND
 
+	if (!exportdir)
+		traceopen(getenv("SENT_TRACE"));
+	/* compiled decks store 8 bit sRGB */
+	if (compileout)
+		linear = 0;
+
 	if (!argv[0] || !strcmp(argv[0], "-"))
 		fp = stdin;
 	else if (!(fp = fopen(fname = argv[0], "r")))
 		die("sent: Unable to open '%s' for reading:", fname);
-	load(fp);
-	fclose(fp);
+
+	/* present slides from pipes as they arrive */
+	if (fp == stdin && !exportdir && !compileout && !fstat(fileno(fp), &st) &&
+	    !S_ISREG(st.st_mode)) {
+		streamfd = fileno(fp);
+	} else {
+		load(fp);
+		fclose(fp);
+	}
+
+	if (compileout) {
+		compile(compileout);
+		return 0;
+	}
+	if (exportdir) {
+		export();
+		return 0;
+	}
 
 	xinit();
+	if (ctlpath)
+		ctlopen(ctlpath);
+	signal(SIGUSR1, sigusr1);
 	run();
 
 	cleanup(0);
+	traceclose();
 	return 0;
 }
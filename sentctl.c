@@ -0,0 +1,98 @@
+/* See LICENSE file for copyright and license details. */
+
+/* sentctl - send commands to the control socket of sent -s
+ *
+ * With a command on the command line it is sent and its reply printed;
+ * without one, commands are read from stdin one per line, so a clicker
+ * daemon can keep a single connection open. */
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "arg.h"
+#include "util.h"
+
+char *argv0;
+
+static int fd;
+
+static void
+usage(void)
+{
+	die("usage: %s socket [command [argument]]", argv0);
+}
+
+/* send line and print the reply, returning whether it is ok */
+static int
+command(const char *line)
+{
+	char reply[128];
+	size_t len = 0;
+	ssize_t n;
+
+	if (write(fd, line, strlen(line)) < 0)
+		die("sentctl: Unable to write:");
+	while (!len || reply[len - 1] != '\n') {
+		if ((n = read(fd, reply + len, sizeof(reply) - 1 - len)) <= 0)
+			die("sentctl: Connection closed");
+		if ((len += n) == sizeof(reply) - 1)
+			break;
+	}
+	reply[len] = '\0';
+	fputs(reply, stdout);
+	fflush(stdout);
+	return !strncmp(reply, "ok", 2);
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct sockaddr_un sa = { .sun_family = AF_UNIX };
+	char line[256];
+	size_t len;
+	int c, i, ok = 1;
+
+	ARGBEGIN {
+	default:
+		usage();
+	} ARGEND
+
+	if (argc < 1 || strlen(argv[0]) >= sizeof(sa.sun_path))
+		usage();
+	strcpy(sa.sun_path, argv[0]);
+	if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+		die("sentctl: Unable to create socket:");
+	if (connect(fd, (struct sockaddr *)&sa, sizeof(sa)) < 0)
+		die("sentctl: Unable to connect to '%s':", argv[0]);
+
+	if (argc > 1) {
+		for (i = 1, len = 0; i < argc; i++) {
+			if (len + strlen(argv[i]) + 2 > sizeof(line))
+				die("sentctl: Command too long");
+			len += sprintf(line + len, "%s%s", i > 1 ? " " : "", argv[i]);
+		}
+		strcpy(line + len, "\n");
+		ok = command(line);
+	} else {
+		/* leave room to end the last line with a newline */
+		while (fgets(line, sizeof(line) - 1, stdin)) {
+			len = strlen(line);
+			if (line[len - 1] != '\n' && (c = getchar()) != EOF &&
+			    c != '\n') {
+				while ((c = getchar()) != EOF && c != '\n')
+					;
+				fprintf(stderr, "sentctl: Command too long\n");
+				ok = 0;
+				continue;
+			}
+			if (line[len - 1] != '\n')
+				strcpy(line + len, "\n");
+			ok = command(line) && ok;
+		}
+	}
+	close(fd);
+	return !ok;
+}
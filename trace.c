@@ -0,0 +1,72 @@
+/* See LICENSE file for copyright and license details. */
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "trace.h"
+#include "util.h"
+
+int tracing = 0;
+
+static FILE *tracefp;
+static double traceepoch;
+static const char *tracesep = "";
+
+void
+traceopen(const char *path)
+{
+	if (!path || !path[0])
+		return;
+	if (!(tracefp = fopen(path, "w")))
+		die("sent: Unable to open trace file '%s':", path);
+	fputs("[\n", tracefp);
+	traceepoch = 0;
+	traceepoch = tracenow();
+	tracing = 1;
+}
+
+void
+traceclose(void)
+{
+	if (!tracing)
+		return;
+	fputs("\n]\n", tracefp);
+	fclose(tracefp);
+	tracing = 0;
+}
+
+/* microseconds since traceopen() */
+double
+tracenow(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3 - traceepoch;
+}
+
+/* emit a complete event lasting from start until now; slide < 0 omits
+ * the slide argument */
+void
+traceevent(const char *name, double start, int slide)
+{
+	double end = tracenow();
+
+	fprintf(tracefp, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":0,"
+	        "\"ts\":%.3f,\"dur\":%.3f", tracesep, name, (int)getpid(),
+	        start, end - start);
+	if (slide >= 0)
+		fprintf(tracefp, ",\"args\":{\"slide\":%d}", slide);
+	fputc('}', tracefp);
+	tracesep = ",\n";
+}
+
+/* emit the current value of a counter, drawn as a graph over time */
+void
+tracecounter(const char *name, long value)
+{
+	fprintf(tracefp, "%s{\"name\":\"%s\",\"ph\":\"C\",\"pid\":%d,\"tid\":0,"
+	        "\"ts\":%.3f,\"args\":{\"value\":%ld}}", tracesep, name,
+	        (int)getpid(), tracenow(), value);
+	tracesep = ",\n";
+}
@@ -0,0 +1,16 @@
+/* See LICENSE file for copyright and license details. */
+
+/* Phase tracing in Chrome trace-event format. Everything is a no-op
+ * unless traceopen() was given a path, so call sites only pay for a
+ * branch on the tracing flag. */
+extern int tracing;
+
+void traceopen(const char *path);
+void traceclose(void);
+double tracenow(void);
+void traceevent(const char *name, double start, int slide);
+void tracecounter(const char *name, long value);
+
+#define TRACEBEGIN(t)            ((t) = tracing ? tracenow() : 0)
+#define TRACEEND(name, t, slide) do { if (tracing) traceevent((name), (t), (slide)); } while (0)
+#define TRACECOUNT(name, value)  do { if (tracing) tracecounter((name), (value)); } while (0)
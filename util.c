@@ -6,6 +6,23 @@
 
 #include "util.h"
 
+#define ARENABLOCK  (64 * 1024)
+#define ARENAALIGN  16
+#define POOLMIN     12 /* smallest size class is 4 KiB */
+#define POOLCLASSES 20 /* largest is 2 GiB, bigger buffers are not pooled */
+#define POOLMAX     ((size_t)1 << (POOLCLASSES - 1 + POOLMIN))
+
+struct ArenaBlock {
+	ArenaBlock *next;
+	size_t len, cap;
+};
+
+/* keep the payload of every block aligned */
+#define BLOCKHDR (((sizeof(ArenaBlock) + ARENAALIGN - 1) / ARENAALIGN) * ARENAALIGN)
+
+static void *pool[POOLCLASSES];
+static unsigned long poolhits, poolmisses;
+
 void *
 ecalloc(size_t nmemb, size_t size)
 {
@@ -33,3 +50,153 @@ die(const char *fmt, ...) {
 
 	exit(1);
 }
+
+static ArenaBlock *
+arenablock(size_t size, ArenaBlock *next)
+{
+	ArenaBlock *b;
+
+	if (!(b = malloc(BLOCKHDR + size)))
+		die("malloc:");
+	b->next = next;
+	b->len = 0;
+	b->cap = size;
+	return b;
+}
+
+void *
+arenaalloc(Arena *a, size_t size)
+{
+	ArenaBlock *b;
+	void *p;
+
+	size = (size + ARENAALIGN - 1) / ARENAALIGN * ARENAALIGN;
+	if (!a->cur) {
+		a->head = a->cur = arenablock(MAX(size, ARENABLOCK), NULL);
+	} else if (a->cur->len + size > a->cur->cap) {
+		/* move on to the next kept block, or insert a new, larger one */
+		if ((b = a->cur->next) && b->cap >= size) {
+			b->len = 0;
+		} else {
+			b = arenablock(MAX(size, 2 * a->cur->cap), a->cur->next);
+			a->cur->next = b;
+		}
+		a->cur = b;
+	}
+	p = (char *)a->cur + BLOCKHDR + a->cur->len;
+	a->cur->len += size;
+	return p;
+}
+
+/* drop every allocation at once; blocks are reused by later allocations */
+void
+arenareset(Arena *a)
+{
+	if ((a->cur = a->head))
+		a->cur->len = 0;
+}
+
+void
+arenafree(Arena *a)
+{
+	ArenaBlock *b, *next;
+
+	for (b = a->head; b; b = next) {
+		next = b->next;
+		free(b);
+	}
+	a->head = a->cur = NULL;
+}
+
+/* bytes of the blocks kept, in use or not */
+size_t
+arenasize(Arena *a)
+{
+	ArenaBlock *b;
+	size_t n = 0;
+
+	for (b = a->head; b; b = b->next)
+		n += BLOCKHDR + b->cap;
+	return n;
+}
+
+static unsigned int
+poolclass(size_t size)
+{
+	unsigned int c = 0;
+
+	while (((size_t)1 << (c + POOLMIN)) < size)
+		c++;
+	return c;
+}
+
+/* the returned buffer is not cleared */
+void *
+poolget(size_t size)
+{
+	unsigned int c;
+	void *p;
+
+	if (size > POOLMAX) {
+		if (!(p = malloc(size)))
+			die("malloc:");
+		return p;
+	}
+	c = poolclass(size);
+	if ((p = pool[c])) {
+		pool[c] = *(void **)p;
+		poolhits++;
+		return p;
+	}
+	poolmisses++;
+	if (!(p = malloc((size_t)1 << (c + POOLMIN))))
+		die("malloc:");
+	return p;
+}
+
+/* size has to be the one p was requested with */
+void
+poolput(void *p, size_t size)
+{
+	unsigned int c;
+
+	if (!p)
+		return;
+	if (size > POOLMAX) {
+		free(p);
+		return;
+	}
+	c = poolclass(size);
+	*(void **)p = pool[c];
+	pool[c] = p;
+}
+
+void
+poolfree(void)
+{
+	unsigned int c;
+	void *p;
+
+	for (c = 0; c < POOLCLASSES; c++) {
+		while ((p = pool[c])) {
+			pool[c] = *(void **)p;
+			free(p);
+		}
+	}
+}
+
+/* bytes of the buffers waiting to be reused, and how often poolget()
+ * found one */
+void
+poolstats(size_t *idle, unsigned long *hits, unsigned long *misses)
+{
+	unsigned int c;
+	void *p;
+
+	*idle = 0;
+	for (c = 0; c < POOLCLASSES; c++)
+		for (p = pool[c]; p; p = *(void **)p)
+			*idle += (size_t)1 << (c + POOLMIN);
+	*hits = poolhits;
+	*misses = poolmisses;
+}
@@ -6,3 +6,21 @@
 
 void die(const char *fmt, ...);
 void *ecalloc(size_t nmemb, size_t size);
+
+/* Arena: bump allocator whose blocks are kept and reused after a reset */
+typedef struct ArenaBlock ArenaBlock;
+typedef struct {
+	ArenaBlock *head; /* first block */
+	ArenaBlock *cur;  /* block currently allocated from */
+} Arena;
+
+void *arenaalloc(Arena *a, size_t size);
+void arenareset(Arena *a);
+void arenafree(Arena *a);
+size_t arenasize(Arena *a);
+
+/* Pool: large buffers recycled by power-of-two size class */
+void *poolget(size_t size);
+void poolput(void *p, size_t size);
+void poolfree(void);
+void poolstats(size_t *idle, unsigned long *hits, unsigned long *misses);